@@ -0,0 +1,551 @@
+#include "Endgame.h"
+#include "Evaluator.h"
+#include "Params.h"
+#include "Timeline.h"
+#include "Timer.h"
+#include "TranspositionTable.h"
+#include "Zobrist.h"
+#include <algorithm>
+#include <cstdlib>
+
+namespace {
+
+// Stored as the depth of results that do not depend on any guessed leaf,
+// that is lines played out to the end of the game within the generated
+// moves.
+const int kPlayedOutDepth = 255;
+
+// Keys that tell apart the two kinds of node for the same position: the
+// start of a turn (our choice) and after our orders (the enemy's choice).
+// The table outlives a game turn, so the key also holds how many turns the
+// game had left at the root: the same position searched on a later turn
+// ends sooner and has a different value.
+template <class State>
+uint64_t NodeKey(const State& state, int turns_left, int side) {
+  return state.Hash() ^ Zobrist::Mix(((uint64_t)turns_left << 32) |
+                                     ((uint64_t)state.Turn() << 1) | side);
+}
+
+// Ships player needs to land on planet_id in turns turns for the planet to
+// be theirs then and to stay theirs over the timeline, or 0 if it already
+// will be.
+int ShipsNeeded(const Timeline& timeline, int planet_id, int turns,
+                int player) {
+  if (timeline.Owner(planet_id, turns) != player)
+    return timeline.Ships(planet_id, turns) + 1;
+  for (int t = turns + 1; t <= timeline.Horizon(); ++t) {
+    if (timeline.Owner(planet_id, t) != player)
+      return timeline.Ships(planet_id, t) + 1;
+  }
+  return 0;
+}
+
+// Orders planets by their distance to a destination.
+class ByDistance {
+ public:
+  ByDistance(const MapGeometry& map, int destination)
+      : map_(map), destination_(destination) {}
+
+  bool operator()(int a, int b) const {
+    return map_.Distance(a, destination_) < map_.Distance(b, destination_);
+  }
+
+ private:
+  const MapGeometry& map_;
+  int destination_;
+};
+
+
+// Copies state into the type the search runs on.
+void Pack(const GameState& state, GameState *packed) {
+  packed->CopyFrom(state);
+}
+
+template <int kMaxPlanets, int kMaxFleets, int kMaxOwner>
+void Pack(const GameState& state,
+          FixedGameState<kMaxPlanets, kMaxFleets, kMaxOwner> *packed) {
+  packed->Pack(state);
+}
+
+// GameState grows as needed; a FixedGameState can run out of fleet slots.
+bool OutOfFleets(const GameState&) {
+  return false;
+}
+
+template <int kMaxPlanets, int kMaxFleets, int kMaxOwner>
+bool OutOfFleets(
+    const FixedGameState<kMaxPlanets, kMaxFleets, kMaxOwner>& state) {
+  return state.Overflowed();
+}
+
+// The search itself, for one kind of state.
+template <class State>
+class EndgameSearch {
+ public:
+  typedef EndgameSolver::Order Order;
+  typedef EndgameSolver::Result Result;
+  static const int kWin = EndgameSolver::kWin;
+
+  EndgameSearch(const MapGeometry& map, const Params& params,
+                TranspositionTable *table, int turns_left, double budget_ms)
+      : map_(map),
+        params_(params),
+        table_(table),
+        budget_ms_(budget_ms),
+        turns_left_(turns_left),
+        nodes_(0),
+        aborted_(false),
+        overflowed_(false),
+        heuristic_leaves_(0),
+        root_best_(-1) {
+    evaluator_.SetMap(map);
+    evaluator_.SetWeights(params);
+  }
+
+  // Same as EndgameSolver::Solve().
+  bool Run(const State& state, Result *result);
+
+  // True if the last Run() was cut short because a line of play needed more
+  // fleets than State can hold.
+  bool Overflowed() const { return overflowed_; }
+
+ private:
+  // One candidate set of orders, stored in a Ply's order pool.
+  struct Move {
+    int first_order;
+    int num_orders;
+    int rank;
+
+    bool operator<(const Move& other) const { return rank > other.rank; }
+  };
+
+  // Scratch space for one level of the search, reused between nodes.
+  struct Ply {
+    State child;
+    Timeline timeline;
+    std::vector<Move> moves;
+    std::vector<Order> orders;
+    std::vector<int> sources;
+  };
+
+  void GenerateMoves(const State& state, int player, Ply& ply);
+  int SearchMax(const State& state, int depth, int alpha, int beta, int ply);
+  int SearchMin(const State& state, int depth, int alpha, int beta, int ply);
+  bool Terminal(const State& state, int *score) const;
+  int Evaluate(const State& state);
+  bool OutOfTime();
+
+  const MapGeometry& map_;
+  const Params& params_;
+  TranspositionTable *table_;
+  std::vector<Ply> plies_;
+  Evaluator evaluator_;
+
+  Timer timer_;
+  double budget_ms_;
+  int turns_left_;
+  long nodes_;
+  bool aborted_;
+  bool overflowed_;
+  // Leaves scored by Evaluate() rather than by the end of the game.
+  long heuristic_leaves_;
+  // Index of the best move at the root in the current iteration.
+  int root_best_;
+};
+
+template <class State>
+bool EndgameSearch<State>::Run(const State& state, Result *result) {
+  timer_.Start();
+  nodes_ = 0;
+  aborted_ = false;
+  overflowed_ = false;
+  plies_.resize(2 * params_.endgame_depth + 2);
+
+  bool found = false;
+  for (int depth = 1; depth <= params_.endgame_depth; ++depth) {
+    heuristic_leaves_ = 0;
+    root_best_ = -1;
+    int score = SearchMax(state, depth, -kWin - 1, kWin + 1, 0);
+    if (aborted_)
+      break;
+    found = true;
+    result->orders.clear();
+    if (root_best_ >= 0) {
+      const Ply& root = plies_[0];
+      const Move& m = root.moves[root_best_];
+      result->orders.assign(root.orders.begin() + m.first_order,
+                            root.orders.begin() + m.first_order +
+                            m.num_orders);
+    }
+    result->score = score;
+    result->depth = depth;
+    result->played_out = heuristic_leaves_ == 0;
+    if (result->played_out)
+      break;
+  }
+  return found;
+}
+
+template <class State>
+void EndgameSearch<State>::GenerateMoves(const State& state, int player,
+                                         Ply& ply) {
+  ply.moves.clear();
+  ply.orders.clear();
+  ply.timeline.Build(state, map_, map_.MaxDistance());
+
+  ply.sources.clear();
+  for (int i = 0; i < state.NumPlanets(); ++i) {
+    const PlanetState& p = state.GetPlanet(i);
+    if (p.owner == player && p.num_ships > 0)
+      ply.sources.push_back(i);
+  }
+
+  // One candidate per target: the closest planets send just enough ships
+  // to take or hold it.
+  for (int target = 0; target < state.NumPlanets(); ++target) {
+    const int owner = state.GetPlanet(target).owner;
+    const int growth = map_.GrowthRate(target);
+    if (owner == 0 && growth == 0)
+      continue;
+    std::sort(ply.sources.begin(), ply.sources.end(),
+              ByDistance(map_, target));
+    const int first = ply.orders.size();
+    int sent = 0;
+    int needed = 0;
+    int distance = 0;
+    for (size_t i = 0; i < ply.sources.size(); ++i) {
+      const int source = ply.sources[i];
+      if (source == target)
+        continue;
+      const int d = map_.Distance(source, target);
+      needed = ShipsNeeded(ply.timeline, target, d, player);
+      if (sent >= needed)
+        break;
+      int ships = std::min((int)state.GetPlanet(source).num_ships,
+                           needed - sent);
+      Order order = { source, target, ships };
+      ply.orders.push_back(order);
+      sent += ships;
+      distance = d;
+    }
+    if (needed == 0 || sent < needed) {
+      ply.orders.resize(first);
+      continue;
+    }
+    // Same payoff measure as the planner's actions: taking an enemy planet
+    // or saving one of ours is worth its growth twice.
+    const int value = owner == 0 ? growth : growth * 2;
+    const int investment = distance + needed / std::max(growth, 1);
+    Move move = { first, (int)ply.orders.size() - first,
+                  (value + 1) * 1000 / (investment + 1) };
+    ply.moves.push_back(move);
+  }
+
+  std::stable_sort(ply.moves.begin(), ply.moves.end());
+  if ((int)ply.moves.size() > params_.endgame_branching)
+    ply.moves.resize(params_.endgame_branching);
+
+  // Everything at once: the candidates in rank order, as long as their
+  // sources still have the ships.
+  if (ply.moves.size() > 1) {
+    std::vector<int>& spare = ply.sources;
+    spare.assign(state.NumPlanets(), 0);
+    for (int i = 0; i < state.NumPlanets(); ++i)
+      spare[i] = state.GetPlanet(i).num_ships;
+    const int first = ply.orders.size();
+    int combined = 0;
+    for (size_t m = 0; m < ply.moves.size(); ++m) {
+      const Move& move = ply.moves[m];
+      bool fits = true;
+      for (int o = 0; o < move.num_orders; ++o) {
+        const Order& order = ply.orders[move.first_order + o];
+        fits = fits && spare[order.source_planet] >= order.num_ships;
+      }
+      if (!fits)
+        continue;
+      for (int o = 0; o < move.num_orders; ++o) {
+        const Order order = ply.orders[move.first_order + o];
+        spare[order.source_planet] -= order.num_ships;
+        ply.orders.push_back(order);
+      }
+      ++combined;
+    }
+    if (combined > 1) {
+      Move move = { first, (int)ply.orders.size() - first,
+                    ply.moves[0].rank + 1 };
+      ply.moves.insert(ply.moves.begin(), move);
+    } else {
+      ply.orders.resize(first);
+    }
+  }
+
+  Move pass = { (int)ply.orders.size(), 0, 0 };
+  ply.moves.push_back(pass);
+}
+
+template <class State>
+bool EndgameSearch<State>::Terminal(const State& state,
+                                    int *score) const {
+  int ships[3] = { 0, 0, 0 };
+  bool alive[3] = { false, false, false };
+  for (int i = 0; i < state.NumPlanets(); ++i) {
+    const PlanetState& p = state.GetPlanet(i);
+    alive[p.owner] = true;
+    ships[p.owner] += p.num_ships;
+  }
+  for (int i = 0; i < state.NumFleets(); ++i) {
+    const FleetState& f = state.GetFleet(i);
+    alive[f.owner] = true;
+    ships[f.owner] += f.num_ships;
+  }
+  const int win = kWin - state.Turn();
+  if (!alive[1] || !alive[2]) {
+    *score = alive[1] ? win : (alive[2] ? -win : 0);
+    return true;
+  }
+  if (state.Turn() >= turns_left_) {
+    *score = ships[1] > ships[2] ? win : (ships[1] < ships[2] ? -win : 0);
+    return true;
+  }
+  return false;
+}
+
+template <class State>
+int EndgameSearch<State>::Evaluate(const State& state) {
+  const int turns = std::min(params_.endgame_growth_turns,
+                             turns_left_ - state.Turn());
+  const int score = evaluator_.Evaluate(state, turns);
+  return std::max(-kWin / 2, std::min(kWin / 2, score));
+}
+
+template <class State>
+bool EndgameSearch<State>::OutOfTime() {
+  if ((++nodes_ & 255) == 0 && timer_.ElapsedMs() > budget_ms_)
+    aborted_ = true;
+  return aborted_;
+}
+
+template <class State>
+int EndgameSearch<State>::SearchMax(const State& state, int depth,
+                                    int alpha, int beta, int ply) {
+  int score;
+  if (Terminal(state, &score))
+    return score;
+  if (depth == 0) {
+    ++heuristic_leaves_;
+    return Evaluate(state);
+  }
+  if (OutOfTime())
+    return 0;
+
+  const uint64_t key = NodeKey(state, turns_left_, 0);
+  int tt_move = -1;
+  TranspositionTable::Entry entry;
+  if (table_->Probe(key, &entry)) {
+    tt_move = entry.best_move;
+    if (ply > 0 && entry.depth >= depth &&
+        (entry.bound == TranspositionTable::kExact ||
+         (entry.bound == TranspositionTable::kLower && entry.score >= beta) ||
+         (entry.bound == TranspositionTable::kUpper &&
+          entry.score <= alpha))) {
+      if (entry.depth != kPlayedOutDepth)
+        ++heuristic_leaves_;
+      return entry.score;
+    }
+  }
+
+  Ply& p = plies_[ply];
+  GenerateMoves(state, 1, p);
+  const int num_moves = p.moves.size();
+  if (tt_move >= num_moves)
+    tt_move = -1;
+
+  const long leaves = heuristic_leaves_;
+  const int original_alpha = alpha;
+  int best = -kWin - 1;
+  int best_move = -1;
+  // The table's best move first, then the rest in generator order.
+  for (int k = tt_move < 0 ? 0 : -1; k < num_moves; ++k) {
+    const int i = k < 0 ? tt_move : k;
+    if (k >= 0 && i == tt_move)
+      continue;
+    const Move& m = p.moves[i];
+    p.child.CopyFrom(state);
+    for (int o = 0; o < m.num_orders; ++o) {
+      const Order& order = p.orders[m.first_order + o];
+      p.child.IssueOrder(map_, order.source_planet, order.destination_planet,
+                         order.num_ships);
+    }
+    if (OutOfFleets(p.child)) {
+      overflowed_ = aborted_ = true;
+      return 0;
+    }
+    const int v = SearchMin(p.child, depth, alpha, beta, ply + 1);
+    if (aborted_)
+      return 0;
+    if (v > best) {
+      best = v;
+      best_move = i;
+      if (ply == 0)
+        root_best_ = i;
+    }
+    alpha = std::max(alpha, v);
+    if (alpha >= beta)
+      break;
+  }
+
+  TranspositionTable::Entry store;
+  store.score = best;
+  store.depth = heuristic_leaves_ == leaves ? kPlayedOutDepth : depth;
+  store.bound = best <= original_alpha ? TranspositionTable::kUpper :
+                best >= beta ? TranspositionTable::kLower :
+                TranspositionTable::kExact;
+  store.best_move = best_move;
+  table_->Store(key, store);
+  return best;
+}
+
+template <class State>
+int EndgameSearch<State>::SearchMin(const State& state, int depth,
+                                    int alpha, int beta, int ply) {
+  if (OutOfTime())
+    return 0;
+
+  const uint64_t key = NodeKey(state, turns_left_, 1);
+  int tt_move = -1;
+  TranspositionTable::Entry entry;
+  if (table_->Probe(key, &entry)) {
+    tt_move = entry.best_move;
+    if (entry.depth >= depth &&
+        (entry.bound == TranspositionTable::kExact ||
+         (entry.bound == TranspositionTable::kLower && entry.score >= beta) ||
+         (entry.bound == TranspositionTable::kUpper &&
+          entry.score <= alpha))) {
+      if (entry.depth != kPlayedOutDepth)
+        ++heuristic_leaves_;
+      return entry.score;
+    }
+  }
+
+  Ply& p = plies_[ply];
+  GenerateMoves(state, 2, p);
+  const int num_moves = p.moves.size();
+  if (tt_move >= num_moves)
+    tt_move = -1;
+
+  const long leaves = heuristic_leaves_;
+  const int original_beta = beta;
+  int best = kWin + 1;
+  int best_move = -1;
+  for (int k = tt_move < 0 ? 0 : -1; k < num_moves; ++k) {
+    const int i = k < 0 ? tt_move : k;
+    if (k >= 0 && i == tt_move)
+      continue;
+    const Move& m = p.moves[i];
+    p.child.CopyFrom(state);
+    for (int o = 0; o < m.num_orders; ++o) {
+      const Order& order = p.orders[m.first_order + o];
+      p.child.IssueOrder(map_, order.source_planet, order.destination_planet,
+                         order.num_ships);
+    }
+    if (OutOfFleets(p.child)) {
+      overflowed_ = aborted_ = true;
+      return 0;
+    }
+    p.child.AdvanceTurn(map_);
+    const int v = SearchMax(p.child, depth - 1, alpha, beta, ply + 1);
+    if (aborted_)
+      return 0;
+    if (v < best) {
+      best = v;
+      best_move = i;
+    }
+    beta = std::min(beta, v);
+    if (alpha >= beta)
+      break;
+  }
+
+  TranspositionTable::Entry store;
+  store.score = best;
+  store.depth = heuristic_leaves_ == leaves ? kPlayedOutDepth : depth;
+  store.bound = best >= original_beta ? TranspositionTable::kLower :
+                best <= alpha ? TranspositionTable::kUpper :
+                TranspositionTable::kExact;
+  store.best_move = best_move;
+  table_->Store(key, store);
+  return best;
+}
+
+}  // namespace
+
+EndgameSolver::EndgameSolver(const MapGeometry& map, const Params& params,
+                             TranspositionTable *table, FixedStateKind kind)
+    : map_(map), params_(params), table_(table), kind_(kind) {
+}
+
+bool EndgameSolver::Applies(const GameState& state, const MapGeometry& map,
+                            const Params& params) {
+  if (state.NumFleets() > params.endgame_fleets)
+    return false;
+  bool alive[3] = { false, false, false };
+  int planets = 0;
+  for (int i = 0; i < state.NumPlanets(); ++i) {
+    const PlanetState& p = state.GetPlanet(i);
+    if (p.owner > 2)
+      return false;
+    alive[p.owner] = true;
+    if (p.owner != 0 || map.GrowthRate(i) > 0)
+      ++planets;
+  }
+  for (int i = 0; i < state.NumFleets(); ++i) {
+    const FleetState& f = state.GetFleet(i);
+    if (f.owner > 2)
+      return false;
+    alive[f.owner] = true;
+  }
+  return alive[1] && alive[2] && planets <= params.endgame_planets;
+}
+
+bool EndgameSolver::Solve(const GameState& position, int turns_left,
+                          double budget_ms, Result *result) {
+  Timer timer;
+  // The search plays the fleets in flight out at every node, so fleets that
+  // land together are merged once up front.
+  GameState state;
+  state.CopyFrom(position);
+  state.CoalesceFleets();
+  bool overflowed = false;
+  bool found;
+  if (kind_ == kSmallState && SmallGameState::Fits(state)) {
+    found = SolveAs<SmallGameState>(state, turns_left, budget_ms, result,
+                                    &overflowed);
+  } else if (kind_ != kDynamicState && LargeGameState::Fits(state)) {
+    found = SolveAs<LargeGameState>(state, turns_left, budget_ms, result,
+                                    &overflowed);
+  } else {
+    return SolveAs<GameState>(state, turns_left, budget_ms, result,
+                              &overflowed);
+  }
+  // The fixed state ran out of fleet slots part way through an iteration.
+  // GameState gets the rest of the budget; the table still holds what the
+  // finished iterations learned, and result keeps their answer if it does
+  // not get further.
+  if (overflowed) {
+    found |= SolveAs<GameState>(state, turns_left,
+                                budget_ms - timer.ElapsedMs(), result,
+                                &overflowed);
+  }
+  return found;
+}
+
+template <class State>
+bool EndgameSolver::SolveAs(const GameState& state, int turns_left,
+                            double budget_ms, Result *result,
+                            bool *overflowed) {
+  State root;
+  Pack(state, &root);
+  EndgameSearch<State> search(map_, params_, table_, turns_left, budget_ms);
+  const bool found = search.Run(root, result);
+  *overflowed = search.Overflowed();
+  return found;
+}
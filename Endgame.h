@@ -0,0 +1,81 @@
+// Search to the end of a game, once only a few planets and fleets are
+// left.
+//
+// The simultaneous-move game is searched as if we moved first and the enemy
+// answered knowing our orders. One ply is one turn: a choice of orders for
+// us, a choice for the enemy, then GameState::AdvanceTurn(). Neither side
+// gets every possible set of orders, only the endgame_branching best
+// candidates of the same kind of heuristic the planner uses, all of them
+// combined, and waiting. The search deepens a turn at a time until the time
+// budget runs out or every line has been played to the end of the game. A
+// played out result is the exact value of the game with both sides held to
+// those moves; it is not a proof about the real game, where either side may
+// have moves the search never tried.
+//
+// The search is written once over the state type. On maps that fit one of
+// the FixedGameStates it runs on that, so copying a node is a memcpy of a
+// size known at compile time; otherwise, or if a line of play runs out of
+// fleet slots, it runs on GameState.
+#ifndef ENDGAME_H_
+#define ENDGAME_H_
+
+#include "FixedGameState.h"
+#include "GameState.h"
+#include <vector>
+
+class Params;
+class TranspositionTable;
+
+class EndgameSolver {
+ public:
+  // Scores are from player 1's point of view. A won game scores kWin minus
+  // the number of turns it takes, a lost game the negative of that.
+  static const int kWin = 1000000;
+
+  struct Order {
+    int source_planet;
+    int destination_planet;
+    int num_ships;
+  };
+
+  struct Result {
+    // Orders for this turn. Empty when the best move is to wait.
+    std::vector<Order> orders;
+    int score;
+    // Turns searched by the last finished iteration.
+    int depth;
+    // True when every line was played out to the end of the game, so score
+    // is a win, a loss or a draw rather than an estimate. It is exact only
+    // within the moves the search generates (see the top of the file).
+    bool played_out;
+  };
+
+  // kind is the state the search should run on when the position fits it,
+  // usually ChooseFixedState() for the map.
+  EndgameSolver(const MapGeometry& map, const Params& params,
+                TranspositionTable *table, FixedStateKind kind = kDynamicState);
+
+  // Returns true if state is small enough for the solver: exactly players 1
+  // and 2 are alive, at most params.endgame_planets planets matter and at
+  // most params.endgame_fleets fleets are in flight.
+  static bool Applies(const GameState& state, const MapGeometry& map,
+                      const Params& params);
+
+  // Searches for player 1's orders for at most budget_ms milliseconds.
+  // turns_left is the number of turns until the game is over. Returns false
+  // if not even a one turn search could be finished.
+  bool Solve(const GameState& state, int turns_left, double budget_ms,
+             Result *result);
+
+ private:
+  template <class State>
+  bool SolveAs(const GameState& state, int turns_left, double budget_ms,
+               Result *result, bool *overflowed);
+
+  const MapGeometry& map_;
+  const Params& params_;
+  TranspositionTable *table_;
+  FixedStateKind kind_;
+};
+
+#endif
@@ -0,0 +1,148 @@
+#include "Evaluator.h"
+#include "FixedGameState.h"
+#include "GameState.h"
+#include "Params.h"
+#include <algorithm>
+
+namespace {
+
+// Row 0 for player 1, 1 for player 2 and 2 for anyone else, without a
+// branch to mispredict.
+inline int SideRow(int owner) {
+  return 2 - 2 * (owner == 1) - (owner == 2);
+}
+
+}  // namespace
+
+Evaluator::Evaluator() : num_planets_(0), stride_(0) {
+  SetWeights(Params());
+}
+
+void Evaluator::SetMap(const MapGeometry& map) {
+  const int n = map.NumPlanets();
+  num_planets_ = n;
+  stride_ = (n + kLanes - 1) / kLanes * kLanes;
+  // Lanes past the last planet stay 0, so they add nothing.
+  growth_.assign(stride_, 0);
+  pressure_.assign(n * stride_, 0.0f);
+  for (int p = 0; p < n; ++p) {
+    growth_[p] = map.GrowthRate(p);
+    for (int q = 0; q < n; ++q) {
+      if (q != p)
+        pressure_[p * stride_ + q] = 1.0f / std::max(1, map.Distance(p, q));
+    }
+  }
+  arriving_.assign(3 * stride_, 0);
+  on_planet_.assign(3 * stride_, 0.0f);
+}
+
+void Evaluator::SetWeights(const Params& params) {
+  weights_.growth = params.eval_growth;
+  weights_.ships = params.eval_ships;
+  weights_.fleets = params.eval_fleets;
+  weights_.pressure = params.eval_pressure;
+  weights_.projected = params.eval_projected;
+}
+
+template <class State>
+void Evaluator::Extract(const State& state, const Features& weights,
+                        Features *features) {
+  // Locals rather than members, so the compiler knows nothing aliases the
+  // loop bounds.
+  const int n = num_planets_;
+  const int stride = stride_;
+  const int32_t *growth = &growth_[0];
+  const PlanetState *planets = &state.GetPlanet(0);
+  const FleetState *fleets = state.NumFleets() > 0 ? &state.GetFleet(0) : 0;
+  const int num_fleets = state.NumFleets();
+
+  int total_growth = 0, total_ships = 0, total_fleets = 0;
+  for (int p = 0; p < n; ++p) {
+    const int32_t side = (planets[p].owner == 1) - (planets[p].owner == 2);
+    total_growth += side * growth[p];
+    total_ships += side * planets[p].num_ships;
+  }
+  for (int i = 0; i < num_fleets; ++i) {
+    const int32_t side = (fleets[i].owner == 1) - (fleets[i].owner == 2);
+    total_fleets += side * fleets[i].num_ships;
+  }
+  features->growth = total_growth;
+  features->ships = total_ships;
+  features->fleets = total_fleets;
+
+  features->projected = 0;
+  if (weights.projected != 0) {
+    // One add per fleet: rows of arriving are player 1, player 2 and
+    // anyone else, who is left out.
+    int32_t *arriving = &arriving_[0];
+    std::fill(arriving, arriving + 3 * stride, 0);
+    for (int i = 0; i < num_fleets; ++i) {
+      const FleetState& f = fleets[i];
+      arriving[SideRow(f.owner) * stride + f.destination_planet] +=
+          f.num_ships;
+    }
+    const int32_t *arriving_mine = arriving;
+    const int32_t *arriving_theirs = arriving + stride;
+    int projected = 0;
+    for (int p = 0; p < n; ++p) {
+      const int32_t m = planets[p].owner == 1;
+      const int32_t t = planets[p].owner == 2;
+      const int32_t s = planets[p].num_ships;
+      // Everything in flight lands at once. A side fights with what it
+      // sends plus the planet's ships if it owns the planet; anyone else's
+      // ships defend on their own. The largest force takes the planet and
+      // a tie leaves it with its owner.
+      const int32_t ours = arriving_mine[p] + m * s;
+      const int32_t enemy = arriving_theirs[p] + t * s;
+      const int32_t other = (1 - m - t) * s;
+      const int32_t ours_wins = ((ours > enemy) & (ours > other)) |
+                                (m & (ours >= enemy) & (ours >= other));
+      const int32_t enemy_wins =
+          ((enemy > ours) & (enemy > other)) |
+          (t & (enemy >= ours) & (enemy >= other));
+      projected += (ours_wins - enemy_wins) * growth[p];
+    }
+    features->projected = projected;
+  }
+
+  features->pressure = 0;
+  if (weights.pressure != 0) {
+    // How hard each side presses on every planet, then summed over the
+    // other side's planets. Rows of the weights are added whole, so the
+    // inner loop has no reduction in it; neutral planets press into a row
+    // that is not read.
+    float *on_planet = &on_planet_[0];
+    std::fill(on_planet, on_planet + 3 * stride, 0.0f);
+    const float *pressure_weights = &pressure_[0];
+    for (int q = 0; q < n; ++q) {
+      float *by_side = on_planet + SideRow(planets[q].owner) * stride;
+      const float *row = pressure_weights + q * stride;
+      const float ships = planets[q].num_ships;
+      for (int p = 0; p < stride; ++p)
+        by_side[p] += ships * row[p];
+    }
+    float pressure = 0;
+    for (int p = 0; p < n; ++p) {
+      pressure += (planets[p].owner == 2) * on_planet[p] -
+                  (planets[p].owner == 1) * on_planet[stride + p];
+    }
+    features->pressure = (int)pressure;
+  }
+}
+
+template void Evaluator::Extract(const GameState&, const Features&,
+                                 Features *);
+template void Evaluator::Extract(const SmallGameState&, const Features&,
+                                 Features *);
+template void Evaluator::Extract(const LargeGameState&, const Features&,
+                                 Features *);
+
+int Evaluator::Score(const Features& features, int growth_turns) const {
+  const int64_t score =
+      (int64_t)weights_.growth * features.growth * growth_turns +
+      (int64_t)weights_.ships * features.ships +
+      (int64_t)weights_.fleets * features.fleets +
+      (int64_t)weights_.pressure * features.pressure +
+      (int64_t)weights_.projected * features.projected * growth_turns;
+  return score / 100;
+}
@@ -0,0 +1,205 @@
+// GameState with its capacity fixed at compile time, for search.
+//
+// Planets and fleets live in std::arrays sized by the template arguments,
+// so a state never touches the heap, is trivially copyable (copying one is
+// a single memcpy of a known size) and the loops over players have
+// constant bounds. The interface is the part of GameState the search uses,
+// and the rules and hash are the same, so search code can be written once
+// as a template over either.
+//
+// SmallGameState holds the bundled maps. ChooseFixedState() picks the
+// smallest instantiation for a map once it is known; maps that fit none of
+// them keep using GameState.
+#ifndef FIXED_GAME_STATE_H_
+#define FIXED_GAME_STATE_H_
+
+#include "GameState.h"
+#include "Zobrist.h"
+#include <algorithm>
+#include <array>
+#include <stdint.h>
+#include <type_traits>
+
+template <int kMaxPlanets, int kMaxFleets, int kMaxOwner>
+class FixedGameState {
+ public:
+  static constexpr int kPlanets = kMaxPlanets;
+  static constexpr int kFleets = kMaxFleets;
+  static constexpr int kOwners = kMaxOwner + 1;
+
+  // Returns true if state can be packed: it has at most kMaxPlanets planets
+  // and kMaxFleets fleets and no owner above kMaxOwner.
+  static bool Fits(const GameState& state) {
+    if (state.NumPlanets() > kMaxPlanets || state.NumFleets() > kMaxFleets)
+      return false;
+    for (int i = 0; i < state.NumPlanets(); ++i) {
+      if (state.GetPlanet(i).owner > kMaxOwner)
+        return false;
+    }
+    for (int i = 0; i < state.NumFleets(); ++i) {
+      if (state.GetFleet(i).owner > kMaxOwner)
+        return false;
+    }
+    return true;
+  }
+
+  // Copies state, which must fit.
+  void Pack(const GameState& state) {
+    num_planets_ = state.NumPlanets();
+    num_fleets_ = state.NumFleets();
+    for (int i = 0; i < num_planets_; ++i)
+      planets_[i] = state.GetPlanet(i);
+    for (int i = 0; i < num_fleets_; ++i)
+      fleets_[i] = state.GetFleet(i);
+    hash_ = state.Hash();
+    turn_ = state.Turn();
+    overflowed_ = false;
+  }
+
+  int NumPlanets() const { return num_planets_; }
+  int NumFleets() const { return num_fleets_; }
+  int Turn() const { return turn_; }
+  uint64_t Hash() const { return hash_; }
+
+  const PlanetState& GetPlanet(int planet_id) const {
+    return planets_[planet_id];
+  }
+  const FleetState& GetFleet(int fleet_id) const { return fleets_[fleet_id]; }
+
+  void CopyFrom(const FixedGameState& other) { *this = other; }
+
+  // True once an order found every fleet slot taken. The fleet was dropped,
+  // so the state no longer follows the rules and should be thrown away.
+  bool Overflowed() const { return overflowed_; }
+
+  // Same as GameState::IssueOrder().
+  void IssueOrder(const MapGeometry& map, int source_planet,
+                  int destination_planet, int num_ships) {
+    if (num_fleets_ == kMaxFleets) {
+      overflowed_ = true;
+      return;
+    }
+    const PlanetState& source = planets_[source_planet];
+    FleetState& f = fleets_[num_fleets_++];
+    f.owner = source.owner;
+    f.num_ships = num_ships;
+    f.source_planet = source_planet;
+    f.destination_planet = destination_planet;
+    f.total_trip_length = map.Distance(source_planet, destination_planet);
+    f.turns_remaining = f.total_trip_length;
+    SetPlanet(source_planet, source.owner, source.num_ships - num_ships);
+    hash_ += Zobrist::FleetKey(f.owner, f.num_ships, f.destination_planet,
+                               turn_ + f.turns_remaining);
+  }
+
+  // Same as GameState::AdvanceTurn(). Arriving ships are added up per
+  // planet and owner, so a battle is a pass over kOwners forces.
+  void AdvanceTurn(const MapGeometry& map) {
+    std::array<std::array<int, kOwners>, kMaxPlanets> arriving;
+    std::array<bool, kMaxPlanets> landed;
+    landed.fill(false);
+    int write = 0;
+    for (int i = 0; i < num_fleets_; ++i) {
+      FleetState f = fleets_[i];
+      if (--f.turns_remaining == 0) {
+        hash_ -= Zobrist::FleetKey(f.owner, f.num_ships, f.destination_planet,
+                                   turn_ + 1);
+        std::array<int, kOwners>& forces = arriving[f.destination_planet];
+        if (!landed[f.destination_planet]) {
+          landed[f.destination_planet] = true;
+          forces.fill(0);
+        }
+        forces[f.owner] += f.num_ships;
+      } else {
+        fleets_[write++] = f;
+      }
+    }
+    num_fleets_ = write;
+    ++turn_;
+
+    for (int i = 0; i < num_planets_; ++i) {
+      const PlanetState& p = planets_[i];
+      if (p.owner != 0 && map.GrowthRate(i) != 0)
+        SetPlanet(i, p.owner, p.num_ships + map.GrowthRate(i));
+    }
+
+    // The largest force wins and keeps the difference to the second
+    // largest; a tie leaves the owner with no ships.
+    for (int i = 0; i < num_planets_; ++i) {
+      if (!landed[i])
+        continue;
+      std::array<int, kOwners>& forces = arriving[i];
+      forces[planets_[i].owner] += planets_[i].num_ships;
+      int first = 0;
+      for (int o = 1; o < kOwners; ++o) {
+        if (forces[o] > forces[first])
+          first = o;
+      }
+      int second = 0;
+      for (int o = 0; o < kOwners; ++o) {
+        if (o != first && forces[o] > second)
+          second = forces[o];
+      }
+      if (forces[first] > second)
+        SetPlanet(i, first, forces[first] - second);
+      else
+        SetPlanet(i, planets_[i].owner, 0);
+    }
+  }
+
+  uint64_t ComputeHash() const {
+    uint64_t hash = 0;
+    for (int i = 0; i < num_planets_; ++i)
+      hash += Zobrist::PlanetKey(i, planets_[i].owner, planets_[i].num_ships);
+    for (int i = 0; i < num_fleets_; ++i) {
+      const FleetState& f = fleets_[i];
+      hash += Zobrist::FleetKey(f.owner, f.num_ships, f.destination_planet,
+                                turn_ + f.turns_remaining);
+    }
+    return hash;
+  }
+
+ private:
+  void SetPlanet(int planet_id, int owner, int num_ships) {
+    PlanetState& p = planets_[planet_id];
+    hash_ -= Zobrist::PlanetKey(planet_id, p.owner, p.num_ships);
+    p.owner = owner;
+    p.num_ships = std::min(std::max(num_ships, 0), 0xffff);
+    hash_ += Zobrist::PlanetKey(planet_id, p.owner, p.num_ships);
+  }
+
+  std::array<PlanetState, kMaxPlanets> planets_;
+  std::array<FleetState, kMaxFleets> fleets_;
+  uint64_t hash_;
+  int num_planets_;
+  int num_fleets_;
+  int turn_;
+  bool overflowed_;
+};
+
+// The bundled maps have 23 planets. The endgame search only runs with two
+// players left, so two owners are enough for it.
+typedef FixedGameState<24, 64, 2> SmallGameState;
+typedef FixedGameState<64, 160, 2> LargeGameState;
+
+static_assert(std::is_trivially_copyable<SmallGameState>::value,
+              "SmallGameState should be trivially copyable");
+static_assert(std::is_trivially_copyable<LargeGameState>::value,
+              "LargeGameState should be trivially copyable");
+
+enum FixedStateKind {
+  kDynamicState,
+  kSmallState,
+  kLargeState
+};
+
+// The smallest fixed-capacity state for a map with num_planets planets.
+inline FixedStateKind ChooseFixedState(int num_planets) {
+  if (num_planets <= SmallGameState::kPlanets)
+    return kSmallState;
+  if (num_planets <= LargeGameState::kPlanets)
+    return kLargeState;
+  return kDynamicState;
+}
+
+#endif
@@ -0,0 +1,151 @@
+#include "FleetTracker.h"
+#include <algorithm>
+#include <tuple>
+
+const double FleetTracker::kLearningRate = 0.2;
+
+FleetTracker::FleetTracker() : next_id_(0), unexplained_(0) {
+}
+
+FleetTracker::Key::Key(const Fleet& f, int turns)
+    : owner(f.Owner()),
+      num_ships(f.NumShips()),
+      source_planet(f.SourcePlanet()),
+      destination_planet(f.DestinationPlanet()),
+      total_trip_length(f.TotalTripLength()),
+      turns_remaining(turns) {
+}
+
+bool FleetTracker::Key::operator<(const Key& other) const {
+  return std::tie(owner, num_ships, source_planet, destination_planet,
+                  total_trip_length, turns_remaining) <
+         std::tie(other.owner, other.num_ships, other.source_planet,
+                  other.destination_planet, other.total_trip_length,
+                  other.turns_remaining);
+}
+
+bool FleetTracker::Key::operator==(const Key& other) const {
+  return !(*this < other) && !(other < *this);
+}
+
+void FleetTracker::AddLaunch(Habit *habit, int destination, double weight) {
+  for (size_t i = 0; i < habit->destinations.size(); ++i) {
+    if (habit->destinations[i].first == destination) {
+      habit->destinations[i].second += weight;
+      return;
+    }
+  }
+  habit->destinations.push_back(std::make_pair(destination, weight));
+}
+
+void FleetTracker::Update(const PlanetWars& pw) {
+  const int num_planets = pw.NumPlanets();
+  const int num_fleets = pw.NumFleets();
+  const bool first_turn = habits_.empty();
+  if ((int)habits_.size() != num_planets) {
+    Habit habit = { 0, 0.5, std::vector<std::pair<int, double> >() };
+    habits_.assign(num_planets, habit);
+    last_owners_.assign(num_planets, 0);
+    last_ships_.assign(num_planets, 0);
+  }
+
+  // A fleet matches one of last turn's if it has one turn less to go.
+  std::vector<bool> matched(last_.size(), false);
+  std::vector<int> launched(num_planets, 0);
+  ids_.assign(num_fleets, -1);
+  enemy_orders_.clear();
+  unexplained_ = 0;
+  for (int i = 0; i < num_fleets; ++i) {
+    const Fleet& f = pw.GetFleet(i);
+    const Key key(f, f.TurnsRemaining() + 1);
+    std::vector<std::pair<Key, int> >::const_iterator it =
+        std::lower_bound(last_.begin(), last_.end(),
+                         std::make_pair(key, -1));
+    for (; it != last_.end() && it->first == key; ++it) {
+      if (!matched[it - last_.begin()]) {
+        matched[it - last_.begin()] = true;
+        ids_[i] = it->second;
+        break;
+      }
+    }
+    if (ids_[i] >= 0)
+      continue;
+    ids_[i] = next_id_++;
+    if (f.TurnsRemaining() != f.TotalTripLength() - 1) {
+      ++unexplained_;
+    } else if (f.Owner() > 1) {
+      enemy_orders_.push_back(Fleet(f.Owner(), f.NumShips(), f.SourcePlanet(),
+                                    f.DestinationPlanet(),
+                                    f.TotalTripLength(),
+                                    f.TotalTripLength()));
+      if (f.SourcePlanet() >= 0 && f.SourcePlanet() < num_planets)
+        launched[f.SourcePlanet()] += f.NumShips();
+    }
+  }
+
+  last_.clear();
+  for (int i = 0; i < num_fleets; ++i) {
+    const Fleet& f = pw.GetFleet(i);
+    last_.push_back(std::make_pair(Key(f, f.TurnsRemaining()), ids_[i]));
+  }
+  std::sort(last_.begin(), last_.end());
+
+  // The planets the enemy held last turn learn from what they sent.
+  const double k = kLearningRate;
+  for (int p = 0; !first_turn && p < num_planets; ++p) {
+    if (last_owners_[p] <= 1)
+      continue;
+    Habit& habit = habits_[p];
+    habit.rate += k * ((launched[p] > 0 ? 1 : 0) - habit.rate);
+    if (launched[p] == 0)
+      continue;
+    const int available = std::max(last_ships_[p], launched[p]);
+    habit.share += k * ((double)launched[p] / available - habit.share);
+    for (size_t d = 0; d < habit.destinations.size(); ++d)
+      habit.destinations[d].second *= 1 - k;
+  }
+  for (size_t i = 0; !first_turn && i < enemy_orders_.size(); ++i) {
+    const Fleet& f = enemy_orders_[i];
+    const int source = f.SourcePlanet(), destination = f.DestinationPlanet();
+    if (source >= 0 && source < num_planets && destination >= 0 &&
+        destination < num_planets && last_owners_[source] > 1)
+      AddLaunch(&habits_[source], destination, k);
+  }
+
+  for (int p = 0; p < num_planets; ++p) {
+    last_owners_[p] = pw.GetPlanet(p).Owner();
+    last_ships_[p] = pw.GetPlanet(p).NumShips();
+  }
+}
+
+void FleetTracker::Predict(const PlanetWars& pw, int min_rate,
+                           std::vector<Fleet> *fleets) const {
+  const int num_planets = std::min(pw.NumPlanets(), (int)habits_.size());
+  for (int p = 0; p < num_planets; ++p) {
+    const Planet& planet = pw.GetPlanet(p);
+    const Habit& habit = habits_[p];
+    if (planet.Owner() <= 1 || habit.rate * 100 < min_rate)
+      continue;
+    const int ships = (int)(habit.share * planet.NumShips());
+    if (ships <= 0)
+      continue;
+    // The most frequent destination, the lowest id among equals.
+    int destination = -1;
+    double best = 0;
+    for (size_t i = 0; i < habit.destinations.size(); ++i) {
+      const int d = habit.destinations[i].first;
+      const double count = habit.destinations[i].second;
+      if (d != p && d < num_planets && count > 0 &&
+          (destination < 0 || count > best ||
+           (count == best && d < destination))) {
+        destination = d;
+        best = count;
+      }
+    }
+    if (destination < 0)
+      continue;
+    const int distance = pw.Distance(p, destination);
+    fleets->push_back(Fleet(planet.Owner(), ships, p, destination, distance,
+                            distance));
+  }
+}
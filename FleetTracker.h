@@ -0,0 +1,90 @@
+// What the enemy has been doing, pieced together from one snapshot a turn.
+//
+// The engine sends fleets without ids, in no particular order. A fleet seen
+// last turn is seen again this turn with the same owner, ships, source and
+// destination and one turn less to go, so the tracker matches fleets by
+// those fields and gives each a stable id. Any other fleet was launched
+// last turn; an enemy one is an order the enemy gave.
+//
+// From those orders the tracker keeps a decaying average, per enemy
+// planet, of how often it launches, what share of its ships it sends and
+// where they go. Predict() turns the habits of the planets that launch
+// often into the fleets they are expected to launch this turn, so the
+// planner can defend against an attack before it is visible.
+#ifndef FLEET_TRACKER_H_
+#define FLEET_TRACKER_H_
+
+#include "PlanetWars.h"
+#include <utility>
+#include <vector>
+
+class FleetTracker {
+ public:
+  FleetTracker();
+
+  // Matches the fleets of pw, which must be parsed, against the previous
+  // turn's and learns from the enemy's new fleets.
+  void Update(const PlanetWars& pw);
+
+  // The stable id of pw's fleet_id as of the last Update().
+  int FleetId(int fleet_id) const { return ids_[fleet_id]; }
+
+  // The orders the enemy gave last turn, as the fleets they launched.
+  const std::vector<Fleet>& EnemyOrders() const { return enemy_orders_; }
+
+  // Fleets seen without a match that were not launched last turn, which
+  // only happens on the first turn or when a turn was missed.
+  int Unexplained() const { return unexplained_; }
+
+  // Appends a fleet for every enemy planet that launched on at least
+  // min_rate percent of recent turns: the share of its ships it usually
+  // sends, to the destination it usually picks, leaving this turn.
+  void Predict(const PlanetWars& pw, int min_rate,
+               std::vector<Fleet> *fleets) const;
+
+ private:
+  // Weight of the latest turn in the averages. Habits older than about
+  // ten turns hardly count.
+  static const double kLearningRate;
+
+  struct Habit {
+    // How often the planet launched while it was the enemy's, 0 to 1.
+    double rate;
+    // Share of its ships a launch takes, 0 to 1.
+    double share;
+    // Decayed launch counts of the destinations it has sent fleets to, as
+    // (planet, count) pairs. Planets launch to few places, so this stays
+    // short however large the map.
+    std::vector<std::pair<int, double> > destinations;
+  };
+
+  // Every field a fleet keeps from one turn to the next, compared whole so
+  // that no two different fleets match however large the map.
+  struct Key {
+    int owner;
+    int num_ships;
+    int source_planet;
+    int destination_planet;
+    int total_trip_length;
+    int turns_remaining;
+
+    Key(const Fleet& f, int turns);
+    bool operator<(const Key& other) const;
+    bool operator==(const Key& other) const;
+  };
+
+  // Adds weight to habit's count of launches to destination.
+  static void AddLaunch(Habit *habit, int destination, double weight);
+
+  // Keys of last turn's fleets with their ids, sorted.
+  std::vector<std::pair<Key, int> > last_;
+  std::vector<int> last_owners_;
+  std::vector<int> last_ships_;
+  std::vector<int> ids_;
+  int next_id_;
+  int unexplained_;
+  std::vector<Fleet> enemy_orders_;
+  std::vector<Habit> habits_;
+};
+
+#endif
@@ -0,0 +1,174 @@
+#include "GameBatch.h"
+
+#include <algorithm>
+
+namespace {
+
+// Games per vector of the widest registers we build for, 8 lanes of 32
+// bits. Padding games never own anything, so they cost no branches.
+const int kLanes = 8;
+
+}  // namespace
+
+GameBatch::GameBatch(const MapGeometry& map, int num_games)
+    : map_(map),
+      num_games_(num_games),
+      num_planets_(map.NumPlanets()),
+      stride_((num_games + kLanes - 1) / kLanes * kLanes),
+      ring_size_(map.MaxDistance() + 1),
+      head_(0),
+      turn_(0),
+      owners_(num_planets_ * stride_, 0),
+      ships_(num_planets_ * stride_, 0),
+      departed_(num_planets_ * stride_, 0),
+      arrivals_(ring_size_ * 2 * num_planets_ * stride_, 0) {
+}
+
+bool GameBatch::Reset(const GameState& start) {
+  if (start.NumPlanets() != num_planets_)
+    return false;
+  for (int p = 0; p < num_planets_; ++p) {
+    if (start.GetPlanet(p).owner > 2)
+      return false;
+  }
+  for (int i = 0; i < start.NumFleets(); ++i) {
+    const FleetState& f = start.GetFleet(i);
+    if (f.owner < 1 || f.owner > 2 || f.turns_remaining < 1 ||
+        f.turns_remaining >= ring_size_)
+      return false;
+  }
+
+  head_ = 0;
+  turn_ = 0;
+  std::fill(departed_.begin(), departed_.end(), 0);
+  std::fill(arrivals_.begin(), arrivals_.end(), 0);
+  launches_.clear();
+  launched_.clear();
+  for (int p = 0; p < num_planets_; ++p) {
+    const PlanetState& planet = start.GetPlanet(p);
+    std::fill(&owners_[p * stride_], &owners_[p * stride_] + num_games_,
+              planet.owner);
+    std::fill(&ships_[p * stride_], &ships_[p * stride_] + num_games_,
+              planet.num_ships);
+  }
+  for (int i = 0; i < start.NumFleets(); ++i) {
+    const FleetState& f = start.GetFleet(i);
+    int32_t *arriving =
+        &arrivals_[Slot(f.owner, f.destination_planet, f.turns_remaining)];
+    for (int g = 0; g < num_games_; ++g)
+      arriving[g] += f.num_ships;
+  }
+  return true;
+}
+
+void GameBatch::Send(int player, int source_planet, int destination_planet,
+                     int32_t *ships) {
+  if (source_planet == destination_planet) {
+    std::fill(ships, ships + num_games_, 0);
+    return;
+  }
+  Launch launch = { player, destination_planet,
+                    map_.Distance(source_planet, destination_planet),
+                    (int)launched_.size() };
+  launched_.resize(launched_.size() + stride_);
+
+  const int32_t *owners = &owners_[source_planet * stride_];
+  const int32_t *have = &ships_[source_planet * stride_];
+  int32_t *departed = &departed_[source_planet * stride_];
+  int32_t *sent = &launched_[launch.offset];
+  // Bounds are copied so that stores through the lanes cannot change them
+  // as far as the compiler knows, which would keep it from vectorizing.
+  const int games = num_games_;
+  int32_t any = 0;
+  for (int g = 0; g < games; ++g) {
+    int32_t n = std::min(std::max(ships[g], 0), have[g] - departed[g]);
+    n = owners[g] == player ? n : 0;
+    departed[g] += n;
+    sent[g] = n;
+    ships[g] = n;
+    any |= n;
+  }
+  if (any)
+    launches_.push_back(launch);
+  else
+    launched_.resize(launch.offset);
+}
+
+void GameBatch::AdvanceTurn() {
+  const int lanes = stride_;
+  // Departures: this turn's orders join the ring where they will land.
+  for (size_t i = 0; i < launches_.size(); ++i) {
+    const Launch& launch = launches_[i];
+    int32_t *arriving = &arrivals_[Slot(launch.player,
+                                        launch.destination_planet,
+                                        launch.trip)];
+    const int32_t *sent = &launched_[launch.offset];
+    for (int g = 0; g < lanes; ++g)
+      arriving[g] += sent[g];
+  }
+  launches_.clear();
+  launched_.clear();
+  const int size = ships_.size();
+  int32_t *ships = &ships_[0];
+  int32_t *departed = &departed_[0];
+  for (int i = 0; i < size; ++i) {
+    ships[i] -= departed[i];
+    departed[i] = 0;
+  }
+
+  // Every fleet moves one turn closer.
+  head_ = (head_ + 1) % ring_size_;
+  ++turn_;
+
+  // Owned planets grow and the fleets that land fight for them. With two
+  // players every battle is between at most three forces, so it is worked
+  // out in every game without looking at whether anything landed.
+  for (int p = 0; p < num_planets_; ++p) {
+    const int32_t growth = map_.GrowthRate(p);
+    int32_t *owners = &owners_[p * stride_];
+    ships = &ships_[p * stride_];
+    int32_t *landing1 = &arrivals_[Slot(1, p, 0)];
+    int32_t *landing2 = &arrivals_[Slot(2, p, 0)];
+    for (int g = 0; g < lanes; ++g) {
+      const int32_t owner = owners[g];
+      const int32_t held = ships[g] + (owner != 0 ? growth : 0);
+      const int32_t neutral = owner == 0 ? held : 0;
+      const int32_t force1 = landing1[g] + (owner == 1 ? held : 0);
+      const int32_t force2 = landing2[g] + (owner == 2 ? held : 0);
+      const int32_t high = std::max(neutral, force1);
+      const int32_t low = std::min(neutral, force1);
+      const int32_t first = std::max(high, force2);
+      const int32_t second = std::max(low, std::min(high, force2));
+      const int32_t winner = force1 == first ? 1 : force2 == first ? 2 : 0;
+      const bool won = first > second;
+      owners[g] = won ? winner : owner;
+      ships[g] = won ? first - second : 0;
+      landing1[g] = 0;
+      landing2[g] = 0;
+    }
+  }
+}
+
+void GameBatch::Play(BatchPolicy& first, BatchPolicy& second, int turns) {
+  for (int t = 0; t < turns; ++t) {
+    first.Orders(1, *this);
+    second.Orders(2, *this);
+    AdvanceTurn();
+  }
+}
+
+void GameBatch::TotalShips(int player, int32_t *totals) const {
+  const int games = num_games_;
+  std::fill(totals, totals + games, 0);
+  for (int p = 0; p < num_planets_; ++p) {
+    const int32_t *owners = Owners(p);
+    const int32_t *ships = Ships(p);
+    for (int g = 0; g < games; ++g)
+      totals[g] += owners[g] == player ? ships[g] : 0;
+    for (int turns = 1; turns < ring_size_; ++turns) {
+      const int32_t *arriving = Arriving(player, p, turns);
+      for (int g = 0; g < games; ++g)
+        totals[g] += arriving[g];
+    }
+  }
+}
@@ -0,0 +1,357 @@
+#include "GameState.h"
+#include "MapPack.h"
+#include "PlanetWars.h"
+#include "Zobrist.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+static_assert(sizeof(PlanetState) == 4, "PlanetState should stay 4 bytes");
+static_assert(sizeof(FleetState) == 12, "FleetState should stay 12 bytes");
+
+static uint16_t Saturate(int value) {
+  if (value < 0)
+    return 0;
+  if (value > 0xffff)
+    return 0xffff;
+  return value;
+}
+
+// Saturate(), clearing *exact if value did not fit.
+static uint16_t Pack(int value, bool *exact) {
+  const uint16_t packed = Saturate(value);
+  if (packed != value)
+    *exact = false;
+  return packed;
+}
+
+MapGeometry::MapGeometry() : max_distance_(0), layout_hash_(0) {
+}
+
+MapGeometry::MapGeometry(const PlanetWars& pw)
+    : max_distance_(Saturate(pw.MaxDistance())), layout_hash_(0) {
+  const int n = pw.NumPlanets();
+  x_.resize(n);
+  y_.resize(n);
+  growth_rates_.resize(n);
+  if (n <= kMaxTablePlanets)
+    distances_.resize(n * n);
+  for (int i = 0; i < n; ++i) {
+    const Planet& p = pw.GetPlanet(i);
+    x_[i] = p.X();
+    y_[i] = p.Y();
+    growth_rates_[i] = Saturate(p.GrowthRate());
+    if (n <= kMaxTablePlanets) {
+      for (int j = 0; j < n; ++j)
+        distances_[i * n + j] = Saturate(pw.Distance(i, j));
+    }
+  }
+  layout_hash_ = HashLayout(pw);
+}
+
+MapGeometry::MapGeometry(const MapPack& pack, int map)
+    : max_distance_(pack.MaxDistance(map)),
+      layout_hash_(pack.LayoutHash(map)) {
+  const int n = pack.NumPlanets(map);
+  const MapPack::Planet *planets = pack.Planets(map);
+  x_.resize(n);
+  y_.resize(n);
+  growth_rates_.resize(n);
+  for (int i = 0; i < n; ++i) {
+    x_[i] = planets[i].x;
+    y_[i] = planets[i].y;
+    growth_rates_[i] = Saturate(planets[i].growth_rate);
+  }
+  distances_.assign(pack.Distances(map), pack.Distances(map) + n * n);
+}
+
+int MapGeometry::Turns(int source_planet, int destination_planet) const {
+  const double dx = x_[source_planet] - x_[destination_planet];
+  const double dy = y_[source_planet] - y_[destination_planet];
+  return Saturate((int)ceil(sqrt(dx * dx + dy * dy)));
+}
+
+uint64_t MapGeometry::HashLayout(const PlanetWars& pw) {
+  uint64_t hash = 0;
+  for (int i = 0; i < pw.NumPlanets(); ++i) {
+    const Planet& p = pw.GetPlanet(i);
+    const int64_t x = llround(p.X() * 1000), y = llround(p.Y() * 1000);
+    hash = Zobrist::Mix(hash ^ (uint64_t)x);
+    hash = Zobrist::Mix(hash ^ (uint64_t)y);
+    hash = Zobrist::Mix(hash ^ Saturate(p.GrowthRate()));
+  }
+  return hash;
+}
+
+GameState::GameState() : hash_(0), turn_(0), exact_(true) {
+}
+
+GameState::GameState(const PlanetWars& pw) : turn_(0), exact_(true) {
+  planets_.resize(pw.NumPlanets());
+  for (int i = 0; i < pw.NumPlanets(); ++i) {
+    const Planet& p = pw.GetPlanet(i);
+    planets_[i].owner = Pack(p.Owner(), &exact_);
+    planets_[i].num_ships = Pack(p.NumShips(), &exact_);
+  }
+  fleets_.resize(pw.NumFleets());
+  for (int i = 0; i < pw.NumFleets(); ++i) {
+    const Fleet& f = pw.GetFleet(i);
+    FleetState& s = fleets_[i];
+    s.owner = Pack(f.Owner(), &exact_);
+    s.num_ships = Pack(f.NumShips(), &exact_);
+    s.source_planet = Pack(f.SourcePlanet(), &exact_);
+    s.destination_planet = Pack(f.DestinationPlanet(), &exact_);
+    s.total_trip_length = Pack(f.TotalTripLength(), &exact_);
+    s.turns_remaining = Pack(f.TurnsRemaining(), &exact_);
+  }
+  hash_ = ComputeHash();
+}
+
+void GameState::CopyFrom(const GameState& other) {
+  planets_.resize(other.planets_.size());
+  fleets_.resize(other.fleets_.size());
+  if (!planets_.empty())
+    memcpy(&planets_[0], &other.planets_[0],
+           planets_.size() * sizeof(PlanetState));
+  if (!fleets_.empty())
+    memcpy(&fleets_[0], &other.fleets_[0],
+           fleets_.size() * sizeof(FleetState));
+  hash_ = other.hash_;
+  turn_ = other.turn_;
+  exact_ = other.exact_;
+}
+
+int GameState::Bytes() const {
+  return planets_.size() * sizeof(PlanetState) +
+         fleets_.size() * sizeof(FleetState);
+}
+
+void Battle::Add(int owner, int num_ships) {
+  int i = 0;
+  while (i < count_ && forces_[i].owner != owner)
+    ++i;
+  if (i == count_) {
+    if (count_ == kMaxForces)
+      return;
+    forces_[count_].owner = owner;
+    forces_[count_].num_ships = 0;
+    ++count_;
+  }
+  forces_[i].num_ships += num_ships;
+}
+
+void Battle::Resolve(int *owner, int *num_ships) const {
+  int first = 0;
+  int second = -1;
+  for (int i = 1; i < count_; ++i) {
+    if (forces_[i].num_ships > forces_[first].num_ships) {
+      second = first;
+      first = i;
+    } else if (second < 0 ||
+               forces_[i].num_ships > forces_[second].num_ships) {
+      second = i;
+    }
+  }
+  if (second < 0) {
+    *owner = forces_[first].owner;
+    *num_ships = forces_[first].num_ships;
+  } else if (forces_[first].num_ships > forces_[second].num_ships) {
+    *owner = forces_[first].owner;
+    *num_ships = forces_[first].num_ships - forces_[second].num_ships;
+  } else {
+    *owner = forces_[0].owner;
+    *num_ships = 0;
+  }
+}
+
+void GameState::SetPlanet(int planet_id, int owner, int num_ships) {
+  PlanetState& p = planets_[planet_id];
+  hash_ -= Zobrist::PlanetKey(planet_id, p.owner, p.num_ships);
+  p.owner = owner;
+  p.num_ships = Saturate(num_ships);
+  hash_ += Zobrist::PlanetKey(planet_id, p.owner, p.num_ships);
+}
+
+void GameState::IssueOrder(const MapGeometry& map, int source_planet,
+                           int destination_planet, int num_ships) {
+  const PlanetState& source = planets_[source_planet];
+  FleetState f;
+  f.owner = source.owner;
+  f.num_ships = num_ships;
+  f.source_planet = source_planet;
+  f.destination_planet = destination_planet;
+  f.total_trip_length = map.Distance(source_planet, destination_planet);
+  f.turns_remaining = f.total_trip_length;
+  SetPlanet(source_planet, source.owner, source.num_ships - num_ships);
+  fleets_.push_back(f);
+  hash_ += Zobrist::FleetKey(f.owner, f.num_ships, f.destination_planet,
+                             turn_ + f.turns_remaining);
+}
+
+namespace {
+
+struct Arrival {
+  int planet_id;
+  int owner;
+  int num_ships;
+
+  bool operator<(const Arrival& other) const {
+    return planet_id < other.planet_id;
+  }
+};
+
+}  // namespace
+
+void GameState::AdvanceTurn(const MapGeometry& map) {
+  // Fleets move; the ones that land are set aside for the battles.
+  static thread_local std::vector<Arrival> arrivals;
+  arrivals.clear();
+  uint write = 0;
+  for (uint i = 0; i < fleets_.size(); ++i) {
+    FleetState f = fleets_[i];
+    if (--f.turns_remaining == 0) {
+      hash_ -= Zobrist::FleetKey(f.owner, f.num_ships, f.destination_planet,
+                                 turn_ + 1);
+      Arrival a = { f.destination_planet, f.owner, f.num_ships };
+      arrivals.push_back(a);
+    } else {
+      fleets_[write++] = f;
+    }
+  }
+  fleets_.resize(write);
+  ++turn_;
+
+  // Owned planets grow.
+  for (uint i = 0; i < planets_.size(); ++i) {
+    const PlanetState& p = planets_[i];
+    if (p.owner != 0 && map.GrowthRate(i) != 0)
+      SetPlanet(i, p.owner, p.num_ships + map.GrowthRate(i));
+  }
+
+  // Fleets that land fight for their destination.
+  std::sort(arrivals.begin(), arrivals.end());
+  Battle battle;
+  for (uint i = 0; i < arrivals.size(); ) {
+    const int planet_id = arrivals[i].planet_id;
+    battle.Reset(planets_[planet_id].owner, planets_[planet_id].num_ships);
+    for (; i < arrivals.size() && arrivals[i].planet_id == planet_id; ++i)
+      battle.Add(arrivals[i].owner, arrivals[i].num_ships);
+    int owner, num_ships;
+    battle.Resolve(&owner, &num_ships);
+    SetPlanet(planet_id, owner, num_ships);
+  }
+}
+
+void GameState::CoalesceFleets() {
+  // Counting sort by destination and arrival turn, which keeps the fleets
+  // of a bucket in order and costs less than the playing out it saves.
+  static thread_local std::vector<int> starts;
+  static thread_local std::vector<FleetState> sorted;
+  int max_turns = 0;
+  for (uint i = 0; i < fleets_.size(); ++i)
+    max_turns = std::max<int>(max_turns, fleets_[i].turns_remaining);
+  const int stride = max_turns + 1;
+  starts.assign(planets_.size() * stride + 1, 0);
+  for (uint i = 0; i < fleets_.size(); ++i) {
+    const FleetState& f = fleets_[i];
+    ++starts[f.destination_planet * stride + f.turns_remaining + 1];
+  }
+  for (uint b = 1; b < starts.size(); ++b)
+    starts[b] += starts[b - 1];
+  sorted.resize(fleets_.size());
+  for (uint i = 0; i < fleets_.size(); ++i) {
+    const FleetState& f = fleets_[i];
+    sorted[starts[f.destination_planet * stride + f.turns_remaining]++] = f;
+  }
+
+  // Within a bucket, each fleet joins the first of its owner's with room.
+  uint write = 0;
+  uint bucket = 0;
+  for (uint i = 0; i < sorted.size(); ++i) {
+    const FleetState& f = sorted[i];
+    if (i == 0 || f.destination_planet != sorted[i - 1].destination_planet ||
+        f.turns_remaining != sorted[i - 1].turns_remaining)
+      bucket = write;
+    uint j = bucket;
+    while (j < write && (fleets_[j].owner != f.owner ||
+                         fleets_[j].num_ships + f.num_ships > 0xffff))
+      ++j;
+    if (j < write)
+      fleets_[j].num_ships += f.num_ships;
+    else
+      fleets_[write++] = f;
+  }
+  fleets_.resize(write);
+  hash_ = ComputeHash();
+}
+
+uint64_t GameState::ComputeHash() const {
+  uint64_t hash = 0;
+  for (uint i = 0; i < planets_.size(); ++i)
+    hash += Zobrist::PlanetKey(i, planets_[i].owner, planets_[i].num_ships);
+  for (uint i = 0; i < fleets_.size(); ++i) {
+    const FleetState& f = fleets_[i];
+    hash += Zobrist::FleetKey(f.owner, f.num_ships, f.destination_planet,
+                              turn_ + f.turns_remaining);
+  }
+  return hash;
+}
+
+// Packs what the planner sees of a fleet into a key that sorts fleets by
+// destination.
+static uint64_t IncomingKey(const FleetState& f) {
+  return ((uint64_t)f.destination_planet << 48) | ((uint64_t)f.owner << 32) |
+         ((uint64_t)f.turns_remaining << 16) | f.num_ships;
+}
+
+void GameState::ChangedPlanets(const GameState& other,
+                               std::vector<bool>& changed) const {
+  changed.assign(planets_.size(), false);
+  for (uint i = 0; i < planets_.size(); ++i) {
+    changed[i] = planets_[i].owner != other.planets_[i].owner ||
+                 planets_[i].num_ships != other.planets_[i].num_ships;
+  }
+
+  // Walk both sets of fleets in destination order; any fleet without a
+  // twin in the other state marks its destination.
+  std::vector<uint64_t> mine(fleets_.size());
+  std::vector<uint64_t> theirs(other.fleets_.size());
+  for (uint i = 0; i < fleets_.size(); ++i)
+    mine[i] = IncomingKey(fleets_[i]);
+  for (uint i = 0; i < other.fleets_.size(); ++i)
+    theirs[i] = IncomingKey(other.fleets_[i]);
+  std::sort(mine.begin(), mine.end());
+  std::sort(theirs.begin(), theirs.end());
+  uint i = 0;
+  uint j = 0;
+  while (i < mine.size() || j < theirs.size()) {
+    if (j == theirs.size() || (i < mine.size() && mine[i] < theirs[j])) {
+      changed[mine[i++] >> 48] = true;
+    } else if (i == mine.size() || theirs[j] < mine[i]) {
+      changed[theirs[j++] >> 48] = true;
+    } else {
+      ++i;
+      ++j;
+    }
+  }
+}
+
+std::string GameState::ToString(const MapGeometry& map) const {
+  std::string s;
+  char line[128];
+  for (uint i = 0; i < planets_.size(); ++i) {
+    const PlanetState& p = planets_[i];
+    snprintf(line, sizeof(line), "P %.17g %.17g %d %d %d\n", map.X(i),
+             map.Y(i), p.owner, p.num_ships, map.GrowthRate(i));
+    s += line;
+  }
+  for (uint i = 0; i < fleets_.size(); ++i) {
+    const FleetState& f = fleets_[i];
+    snprintf(line, sizeof(line), "F %d %d %d %d %d %d\n", f.owner,
+             f.num_ships, f.source_planet, f.destination_planet,
+             f.total_trip_length, f.turns_remaining);
+    s += line;
+  }
+  return s;
+}
@@ -0,0 +1,204 @@
+// A compact, pointer-free copy of the game state for simulation and search.
+//
+// Everything that never changes during a game (positions, growth rates and,
+// on maps of up to kMaxTablePlanets planets, the distance between every
+// pair of planets) lives once per map in MapGeometry. A GameState only
+// holds what changes from turn to turn, packed into 16-bit fields, so
+// copying a state is two memcpys and never allocates once the destination
+// has grown to size.
+//
+// Bytes per state:
+//   PlanetState   4 bytes   (owner, ships)
+//   FleetState   12 bytes   (owner, ships, source, destination, trip, left)
+//   GameState    4 * planets + 12 * fleets bytes of payload
+// A bundled 23 planet map with 30 fleets in flight is 452 bytes, compared to
+// 23 * 32 + 30 * 16 = 1216 bytes for the Planet/Fleet vectors in PlanetWars.
+//
+// Owners, ship counts, planet ids and trip lengths are 16 bits. PlanetWars
+// keeps ship counts in 32, so a state packed from it says whether everything
+// fit (Exact()); the bot only searches and hashes states that did, and
+// plans the others with the normal planner. Played forward, ship counts
+// saturate at 65535.
+//
+// A GameState can also be played forward: IssueOrder() and AdvanceTurn()
+// follow the rules of the official engine, and the state's Zobrist hash
+// (see Zobrist.h) is kept up to date as they are applied.
+#ifndef GAME_STATE_H_
+#define GAME_STATE_H_
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+class MapPack;
+class PlanetWars;
+
+// Planet positions, growth rates and distances for one map.
+class MapGeometry {
+ public:
+  // Larger maps work distances out when asked rather than keep a table of
+  // every pair, which would take 2 bytes times the planets squared.
+  static const int kMaxTablePlanets = 2048;
+
+  MapGeometry();
+
+  // Builds the geometry for the map pw is playing on.
+  explicit MapGeometry(const PlanetWars& pw);
+
+  // Copies the geometry of one of the maps in pack.
+  MapGeometry(const MapPack& pack, int map);
+
+  // LayoutHash() of the map pw is playing on, without working out the
+  // rest of its geometry.
+  static uint64_t HashLayout(const PlanetWars& pw);
+
+  int NumPlanets() const { return growth_rates_.size(); }
+  int GrowthRate(int planet_id) const { return growth_rates_[planet_id]; }
+  double X(int planet_id) const { return x_[planet_id]; }
+  double Y(int planet_id) const { return y_[planet_id]; }
+
+  // Same as PlanetWars::Distance(), looked up in a table where there is
+  // one.
+  int Distance(int source_planet, int destination_planet) const {
+    if (distances_.empty())
+      return Turns(source_planet, destination_planet);
+    return distances_[source_planet * NumPlanets() + destination_planet];
+  }
+
+  // The longest distance between two planets on the map.
+  int MaxDistance() const { return max_distance_; }
+
+  // Hash of the planets' positions and growth rates, which tells maps apart
+  // whoever is playing on them. Positions are rounded to a thousandth so a
+  // map hashes the same however the engine prints them.
+  uint64_t LayoutHash() const { return layout_hash_; }
+
+ private:
+  int Turns(int source_planet, int destination_planet) const;
+
+  std::vector<double> x_;
+  std::vector<double> y_;
+  std::vector<uint16_t> growth_rates_;
+  std::vector<uint16_t> distances_;  // empty past kMaxTablePlanets
+  int max_distance_;
+  uint64_t layout_hash_;
+};
+
+struct PlanetState {
+  uint16_t owner;
+  uint16_t num_ships;
+};
+
+struct FleetState {
+  uint16_t owner;
+  uint16_t num_ships;
+  uint16_t source_planet;
+  uint16_t destination_planet;
+  uint16_t total_trip_length;
+  uint16_t turns_remaining;
+};
+
+// The fight for one planet when fleets land on it. The largest force takes
+// the planet and keeps the difference to the second largest; a tie leaves
+// the planet with its owner and no ships.
+class Battle {
+ public:
+  // Starts a battle for a planet held by owner with num_ships ships.
+  void Reset(int owner, int num_ships) {
+    forces_[0].owner = owner;
+    forces_[0].num_ships = num_ships;
+    count_ = 1;
+  }
+
+  // Adds ships arriving for owner. Ships of the same owner fight together.
+  void Add(int owner, int num_ships);
+
+  // Returns the planet's owner and ships after the battle.
+  void Resolve(int *owner, int *num_ships) const;
+
+ private:
+  // Players taking part in one battle, including the planet's owner. Ships
+  // of any further players are ignored.
+  static const int kMaxForces = 16;
+
+  struct Force {
+    int owner;
+    int num_ships;
+  };
+
+  Force forces_[kMaxForces];
+  int count_;
+};
+
+class GameState {
+ public:
+  GameState();
+
+  // Packs the planets and fleets of pw.
+  explicit GameState(const PlanetWars& pw);
+
+  int NumPlanets() const { return planets_.size(); }
+  int NumFleets() const { return fleets_.size(); }
+
+  // Number of turns this state has been advanced since it was packed.
+  int Turn() const { return turn_; }
+
+  // False if some value of the PlanetWars this state was packed from did
+  // not fit 16 bits and was saturated, so the state is not the game.
+  bool Exact() const { return exact_; }
+
+  // Hash of the planet owners and ship counts and the fleets in flight.
+  uint64_t Hash() const { return hash_; }
+
+  const PlanetState& GetPlanet(int planet_id) const {
+    return planets_[planet_id];
+  }
+  const FleetState& GetFleet(int fleet_id) const {
+    return fleets_[fleet_id];
+  }
+
+  // Copies other into this state, reusing this state's storage.
+  void CopyFrom(const GameState& other);
+
+  // Number of bytes of planet and fleet data this state holds.
+  int Bytes() const;
+
+  // Sends num_ships ships from source_planet to destination_planet on
+  // behalf of the source planet's owner. The order must be valid.
+  void IssueOrder(const MapGeometry& map, int source_planet,
+                  int destination_planet, int num_ships);
+
+  // Plays out one turn after all orders have been issued: fleets move,
+  // owned planets grow and fleets that arrive fight for their destination.
+  void AdvanceTurn(const MapGeometry& map);
+
+  // Merges the fleets of an owner that land on the same planet on the same
+  // turn into one, which plays out the same for a fraction of the work. The
+  // merged fleet keeps the source of one of them. Meant for states that are
+  // only simulated: the hash changes, and PlanetWars would count the merged
+  // fleets as one (see FleetGroup).
+  void CoalesceFleets();
+
+  // Returns the hash computed from scratch. Only useful to check Hash().
+  uint64_t ComputeHash() const;
+
+  // Marks the planets whose owner, ships or incoming fleets differ between
+  // this state and other, which must be on the same map.
+  void ChangedPlanets(const GameState& other,
+                      std::vector<bool>& changed) const;
+
+  // Writes the state in the engine's format, which PlanetWars can parse.
+  // Positions are written at full precision so distances come out the same.
+  std::string ToString(const MapGeometry& map) const;
+
+ private:
+  void SetPlanet(int planet_id, int owner, int num_ships);
+
+  std::vector<PlanetState> planets_;
+  std::vector<FleetState> fleets_;
+  uint64_t hash_;
+  int turn_;
+  bool exact_;
+};
+
+#endif
@@ -0,0 +1,233 @@
+#include "Influence.h"
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstdlib>
+
+namespace {
+
+struct Point {
+  double x, y;
+
+  bool operator<(const Point& other) const {
+    return x != other.x ? x < other.x : y < other.y;
+  }
+  bool operator==(const Point& other) const {
+    return x == other.x && y == other.y;
+  }
+};
+
+double Cross(const Point& o, const Point& a, const Point& b) {
+  return (a.x - o.x) * (b.y - o.y) - (a.y - o.y) * (b.x - o.x);
+}
+
+double SquaredDistance(const Point& a, const Point& b) {
+  const double dx = a.x - b.x, dy = a.y - b.y;
+  return dx * dx + dy * dy;
+}
+
+// The largest squared distance between two of the points. The farthest
+// pair lies on the convex hull, whose antipodal pairs rotating calipers
+// visit in one turn around it, so this is O(n log n) rather than a look at
+// every pair.
+double SquaredDiameter(std::vector<Point> points) {
+  std::sort(points.begin(), points.end());
+  points.erase(std::unique(points.begin(), points.end()), points.end());
+  const int n = points.size();
+  if (n < 2)
+    return 0;
+  // Andrew's monotone chain, counter-clockwise without collinear points.
+  std::vector<Point> hull(2 * n);
+  int k = 0;
+  for (int i = 0; i < n; ++i) {
+    while (k >= 2 && Cross(hull[k - 2], hull[k - 1], points[i]) <= 0)
+      --k;
+    hull[k++] = points[i];
+  }
+  for (int i = n - 2, lower = k + 1; i >= 0; --i) {
+    while (k >= lower && Cross(hull[k - 2], hull[k - 1], points[i]) <= 0)
+      --k;
+    hull[k++] = points[i];
+  }
+  hull.resize(k - 1);
+  const int h = hull.size();
+  if (h < 3)
+    return SquaredDistance(hull[0], hull[h - 1]);
+  double best = 0;
+  for (int i = 0, j = 1; i < h; ++i) {
+    const int next = (i + 1) % h;
+    while (Cross(hull[i], hull[next], hull[(j + 1) % h]) >
+           Cross(hull[i], hull[next], hull[j]))
+      j = (j + 1) % h;
+    best = std::max(best, std::max(SquaredDistance(hull[i], hull[j]),
+                                   SquaredDistance(hull[next], hull[j])));
+  }
+  return best;
+}
+
+}  // namespace
+
+InfluenceMap::InfluenceMap() : max_distance_(0) {
+}
+
+void InfluenceMap::SetMap(const std::vector<double>& positions) {
+  const int n = positions.size() / 2;
+  positions_ = positions;
+  owners_.assign(n, 0);
+  ships_.assign(n, 0);
+  growth_.assign(n, 0);
+  owned_index_.assign(n, -1);
+  players_.clear();
+  fleets_.assign(n, std::vector<FleetEntry>());
+
+  std::vector<Point> points(n);
+  for (int i = 0; i < n; ++i) {
+    points[i].x = positions_[2 * i];
+    points[i].y = positions_[2 * i + 1];
+  }
+  max_distance_ = (int)ceil(sqrt(SquaredDiameter(points)));
+}
+
+int InfluenceMap::Turns(int a, int b) const {
+  const double dx = positions_[2 * a] - positions_[2 * b];
+  const double dy = positions_[2 * a + 1] - positions_[2 * b + 1];
+  return (int)ceil(sqrt(dx * dx + dy * dy));
+}
+
+InfluenceMap::Player& InfluenceMap::GetPlayer(int player) {
+  if ((int)players_.size() <= player)
+    players_.resize(player + 1);
+  Player& p = players_[player];
+  if ((int)p.reach.size() != NumPlanets()) {
+    p.ships = p.growth = 0;
+    p.planets.clear();
+    p.reach.assign(NumPlanets(), static_cast<int>(kUnreachable));
+    p.cost.assign(NumPlanets(), 0);
+  }
+  return p;
+}
+
+void InfluenceMap::AddOwned(int player, int planet_id) {
+  Player& p = GetPlayer(player);
+  owned_index_[planet_id] = p.planets.size();
+  p.planets.push_back(planet_id);
+  p.ships += ships_[planet_id];
+  p.growth += growth_[planet_id];
+  const int64_t growth = growth_[planet_id];
+  for (int q = 0; q < NumPlanets(); ++q) {
+    const int d = Turns(planet_id, q);
+    p.cost[q] += growth * d;
+    if (d > 0 && d < p.reach[q])
+      p.reach[q] = d;
+  }
+}
+
+void InfluenceMap::RemoveOwned(int player, int planet_id) {
+  Player& p = GetPlayer(player);
+  const int index = owned_index_[planet_id];
+  p.planets[index] = p.planets.back();
+  owned_index_[p.planets[index]] = index;
+  p.planets.pop_back();
+  owned_index_[planet_id] = -1;
+  p.ships -= ships_[planet_id];
+  p.growth -= growth_[planet_id];
+  const int64_t growth = growth_[planet_id];
+  for (int q = 0; q < NumPlanets(); ++q) {
+    const int d = Turns(planet_id, q);
+    p.cost[q] -= growth * d;
+    // Only the planets it was nearest to look for the next nearest.
+    if (d > 0 && d == p.reach[q]) {
+      int reach = kUnreachable;
+      for (size_t i = 0; i < p.planets.size(); ++i) {
+        const int e = Turns(p.planets[i], q);
+        if (e > 0 && e < reach)
+          reach = e;
+      }
+      p.reach[q] = reach;
+    }
+  }
+}
+
+void InfluenceMap::SetPlanet(int planet_id, int owner, int ships,
+                             int growth) {
+  const int old_owner = owners_[planet_id];
+  if (owner == old_owner && growth == growth_[planet_id]) {
+    if (owner != 0)
+      players_[owner].ships += ships - ships_[planet_id];
+    ships_[planet_id] = ships;
+    return;
+  }
+  if (old_owner != 0)
+    RemoveOwned(old_owner, planet_id);
+  owners_[planet_id] = owner;
+  ships_[planet_id] = ships;
+  growth_[planet_id] = growth;
+  if (owner != 0)
+    AddOwned(owner, planet_id);
+}
+
+void InfluenceMap::ClearFleets() {
+  for (size_t i = 0; i < fleets_.size(); ++i)
+    fleets_[i].clear();
+}
+
+void InfluenceMap::AddFleet(int owner, int ships, int destination_planet,
+                            int turns_remaining) {
+  if (owner == 0)
+    return;
+  const int turns = std::min(std::max(turns_remaining, 0), max_distance_);
+  FleetEntry entry = { owner, ships, turns };
+  fleets_[destination_planet].push_back(entry);
+}
+
+int InfluenceMap::Reach(int player, int planet_id) const {
+  if (player <= 0 || player >= (int)players_.size() ||
+      players_[player].reach.empty())
+    return kUnreachable;
+  return players_[player].reach[planet_id];
+}
+
+int InfluenceMap::Earliest(int player, int planet_id) const {
+  return owners_[planet_id] == player ? 0 : Reach(player, planet_id);
+}
+
+int InfluenceMap::Strength(int player, int planet_id, int turns) const {
+  int64_t ships = 0;
+  if (player > 0 && player < (int)players_.size() &&
+      !players_[player].reach.empty()) {
+    const Player& p = players_[player];
+    if (turns >= max_distance_) {
+      // Every planet is near enough.
+      ships = p.ships + p.growth * turns - p.cost[planet_id];
+    } else {
+      for (size_t i = 0; i < p.planets.size(); ++i) {
+        const int q = p.planets[i];
+        const int d = Turns(q, planet_id);
+        if (d <= turns)
+          ships += ships_[q] + (int64_t)growth_[q] * (turns - d);
+      }
+    }
+  }
+  const std::vector<FleetEntry>& fleets = fleets_[planet_id];
+  for (size_t i = 0; i < fleets.size(); ++i) {
+    if (fleets[i].owner == player && fleets[i].turns <= turns)
+      ships += fleets[i].ships;
+  }
+  return (int)std::min<int64_t>(std::max<int64_t>(ships, INT_MIN), INT_MAX);
+}
+
+void InfluenceMap::Frontier(int player, int margin,
+                            std::vector<int> *frontier) const {
+  frontier->clear();
+  for (int q = 0; q < NumPlanets(); ++q) {
+    const int mine = Earliest(player, q);
+    int theirs = kUnreachable;
+    for (int other = 1; other < (int)players_.size(); ++other) {
+      if (other != player)
+        theirs = std::min(theirs, Earliest(other, q));
+    }
+    if (mine < kUnreachable && theirs < kUnreachable &&
+        std::abs(mine - theirs) <= margin)
+      frontier->push_back(q);
+  }
+}
@@ -0,0 +1,94 @@
+// Who could reach each planet, how soon and with how much.
+//
+// For every player and every planet the map keeps the earliest turn another
+// planet of the player could land ships there (Reach()), and the sum over
+// the player's planets of growth times distance, which is all Strength()
+// needs beyond the player's totals once every planet is near enough. Memory
+// is a few numbers per player and planet; distances are worked out when
+// needed rather than stored.
+//
+// The map is kept up to date across turns by applying what changed:
+// SetPlanet() with the same owner only moves the player's ship total, and a
+// change of owner costs one pass over the planets (plus, for the planets
+// whose nearest planet of the old owner it was, a pass over the old owner's
+// planets). Fleets move every turn, so they are dropped and added again,
+// one step per fleet.
+#ifndef INFLUENCE_H_
+#define INFLUENCE_H_
+
+#include <stdint.h>
+#include <vector>
+
+class InfluenceMap {
+ public:
+  // Reach() of a planet no other planet of the player can send ships to.
+  static const int kUnreachable = 1 << 20;
+
+  InfluenceMap();
+
+  // Sets up a map of planets at the given positions, x and y of each
+  // planet in turn, every one of them neutral and with no fleets about.
+  void SetMap(const std::vector<double>& positions);
+
+  // Records the owner, ships and growth of a planet. Neutral planets count
+  // for no one.
+  void SetPlanet(int planet_id, int owner, int ships, int growth);
+
+  // Removes every fleet, or adds one. Neutral fleets are ignored.
+  void ClearFleets();
+  void AddFleet(int owner, int ships, int destination_planet,
+                int turns_remaining);
+
+  // The fewest turns in which ships from another planet of player could
+  // land on planet_id.
+  int Reach(int player, int planet_id) const;
+
+  // The most ships player could have on or landed at planet_id within
+  // turns turns: the planet's own ships if it is theirs, every planet of
+  // theirs near enough with the growth it makes until it has to launch,
+  // and their fleets arriving in time.
+  int Strength(int player, int planet_id, int turns) const;
+
+  // Fills frontier with the planets, by id, where player and the nearest
+  // other player could both have ships, and the earlier of them no more
+  // than margin turns before the other: where their reach meets. A player
+  // reaches its own planets at once.
+  void Frontier(int player, int margin, std::vector<int> *frontier) const;
+
+  // The longest distance between two planets.
+  int MaxDistance() const { return max_distance_; }
+
+ private:
+  struct Player {
+    int64_t ships;
+    int64_t growth;
+    std::vector<int> planets;
+    std::vector<int> reach;
+    std::vector<int64_t> cost;  // sum of growth * distance
+  };
+
+  struct FleetEntry {
+    int owner;
+    int ships;
+    int turns;
+  };
+
+  int NumPlanets() const { return owners_.size(); }
+  int Turns(int a, int b) const;
+  // The earliest turn player could have ships on planet_id.
+  int Earliest(int player, int planet_id) const;
+  Player& GetPlayer(int player);
+  void AddOwned(int player, int planet_id);
+  void RemoveOwned(int player, int planet_id);
+
+  std::vector<double> positions_;
+  std::vector<int> owners_;
+  std::vector<int> ships_;
+  std::vector<int> growth_;
+  std::vector<int> owned_index_;  // into Player::planets
+  std::vector<Player> players_;   // by owner; 0 stays empty
+  std::vector<std::vector<FleetEntry> > fleets_;  // by destination
+  int max_distance_;
+};
+
+#endif
@@ -0,0 +1,205 @@
+#include "MapPack.h"
+#include "GameState.h"
+#include "PlanetWars.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <sstream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+const char kMagic[8] = { 'P', 'W', 'M', 'A', 'P', 'S', 0, 0 };
+const uint32_t kVersion = 2;
+
+// Maps the whole pack in at once rather than a page fault at a time.
+#ifdef MAP_POPULATE
+const int kPopulate = MAP_POPULATE;
+#else
+const int kPopulate = 0;
+#endif
+
+}  // namespace
+
+MapPack::MapPack() : data_(0), size_(0), header_(0), entries_(0) {
+}
+
+MapPack::~MapPack() {
+  Close();
+}
+
+bool MapPack::Open(const std::string& path) {
+  Close();
+  const int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0)
+    return false;
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(Header)) {
+    close(fd);
+    return false;
+  }
+  void *data = mmap(0, st.st_size, PROT_READ, MAP_SHARED | kPopulate, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED)
+    return false;
+  data_ = data;
+  size_ = st.st_size;
+
+  const Header *header = static_cast<const Header *>(data_);
+  if (memcmp(header->magic, kMagic, sizeof(kMagic)) != 0 ||
+      header->version != kVersion || header->size != size_ ||
+      sizeof(Header) + (uint64_t)header->num_maps * sizeof(Entry) > size_) {
+    Close();
+    return false;
+  }
+  // Every entry has to point inside the file, so lookups need no checks.
+  const Entry *entries = reinterpret_cast<const Entry *>(header + 1);
+  for (uint32_t m = 0; m < header->num_maps; ++m) {
+    const Entry& e = entries[m];
+    const uint64_t n = e.num_planets;
+    if (e.planets + n * sizeof(Planet) > size_ ||
+        e.distances + n * n * sizeof(uint16_t) > size_ || e.name >= size_ ||
+        !memchr(At<char>(e.name), 0, size_ - e.name)) {
+      Close();
+      return false;
+    }
+  }
+  header_ = header;
+  entries_ = entries;
+  return true;
+}
+
+void MapPack::Close() {
+  if (data_)
+    munmap(data_, size_);
+  data_ = 0;
+  size_ = 0;
+  header_ = 0;
+  entries_ = 0;
+}
+
+int MapPack::Find(uint64_t layout_hash) const {
+  if (!header_)
+    return -1;
+  int low = 0, high = header_->num_maps;
+  while (low < high) {
+    const int mid = (low + high) / 2;
+    if (entries_[mid].layout_hash < layout_hash)
+      low = mid + 1;
+    else
+      high = mid;
+  }
+  if (low == (int)header_->num_maps ||
+      entries_[low].layout_hash != layout_hash)
+    return -1;
+  return low;
+}
+
+namespace {
+
+// A map read for the pack.
+struct PackedMap {
+  std::string name;
+  MapGeometry geometry;
+  std::vector<MapPack::Planet> planets;
+};
+
+bool ByLayout(const PackedMap& a, const PackedMap& b) {
+  return a.geometry.LayoutHash() < b.geometry.LayoutHash();
+}
+
+}  // namespace
+
+bool MapPack::Write(const std::string& path,
+                    const std::vector<std::string>& paths, std::string *error) {
+  std::vector<PackedMap> maps(paths.size());
+  for (size_t i = 0; i < paths.size(); ++i) {
+    std::ifstream in(paths[i].c_str());
+    std::stringstream text;
+    text << in.rdbuf();
+    const PlanetWars pw(text.str());
+    if (!in.is_open() || pw.NumPlanets() == 0) {
+      *error = "cannot read " + paths[i];
+      return false;
+    }
+    PackedMap& map = maps[i];
+    map.name = paths[i].substr(paths[i].rfind('/') + 1);
+    map.geometry = MapGeometry(pw);
+    for (int p = 0; p < pw.NumPlanets(); ++p) {
+      const ::Planet& planet = pw.GetPlanet(p);
+      Planet packed = { planet.X(), planet.Y(), planet.Owner(),
+                        planet.NumShips(), planet.GrowthRate(), 0 };
+      map.planets.push_back(packed);
+    }
+  }
+  std::sort(maps.begin(), maps.end(), ByLayout);
+  for (size_t i = 1; i < maps.size(); ++i) {
+    if (maps[i].geometry.LayoutHash() == maps[i - 1].geometry.LayoutHash()) {
+      *error = maps[i - 1].name + " and " + maps[i].name +
+               " have the same layout";
+      return false;
+    }
+  }
+
+  // Lays the sections out one after the other, working out the offsets.
+  std::vector<Entry> entries(maps.size());
+  uint64_t offset = sizeof(Header) + maps.size() * sizeof(Entry);
+  for (size_t i = 0; i < maps.size(); ++i) {
+    entries[i].layout_hash = maps[i].geometry.LayoutHash();
+    entries[i].num_planets = maps[i].planets.size();
+    entries[i].max_distance = maps[i].geometry.MaxDistance();
+    entries[i].planets = offset;
+    offset += maps[i].planets.size() * sizeof(Planet);
+  }
+  std::vector<uint16_t> tables;
+  for (size_t i = 0; i < maps.size(); ++i) {
+    const MapGeometry& geometry = maps[i].geometry;
+    const int n = geometry.NumPlanets();
+    entries[i].distances = offset + tables.size() * sizeof(uint16_t);
+    for (int p = 0; p < n; ++p) {
+      for (int q = 0; q < n; ++q)
+        tables.push_back(geometry.Distance(p, q));
+    }
+  }
+  offset += tables.size() * sizeof(uint16_t);
+  std::string names;
+  for (size_t i = 0; i < maps.size(); ++i) {
+    entries[i].name = offset + names.size();
+    names += maps[i].name;
+    names += '\0';
+  }
+
+  Header header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, kMagic, sizeof(kMagic));
+  header.version = kVersion;
+  header.num_maps = maps.size();
+  header.size = offset + names.size();
+
+  FILE *f = fopen(path.c_str(), "wb");
+  if (!f) {
+    *error = "cannot write " + path;
+    return false;
+  }
+  bool ok = fwrite(&header, sizeof(header), 1, f) == 1;
+  if (!entries.empty())
+    ok = ok && fwrite(&entries[0], sizeof(Entry), entries.size(), f) ==
+               entries.size();
+  for (size_t i = 0; i < maps.size(); ++i) {
+    ok = ok && fwrite(&maps[i].planets[0], sizeof(Planet),
+                      maps[i].planets.size(), f) == maps[i].planets.size();
+  }
+  if (!tables.empty())
+    ok = ok && fwrite(&tables[0], sizeof(uint16_t), tables.size(), f) ==
+               tables.size();
+  ok = ok && fwrite(names.data(), 1, names.size(), f) == names.size();
+  if (fclose(f) != 0 || !ok) {
+    *error = "cannot write " + path;
+    return false;
+  }
+  return true;
+}
@@ -0,0 +1,114 @@
+// The maps in maps/, compiled ahead of time into one file by
+// tools/PackMaps.cc (make maps.pack).
+//
+// Everything that only depends on the map is in the pack: where the planets
+// are and how they start, the distance between every pair, and the layout
+// hash (MapGeometry::LayoutHash()) the map is found by. A process that finds
+// its map in the pack skips the square roots, and since the file is mapped
+// read-only, every bot and tool running at the same time shares one copy of
+// it.
+//
+// The file is used in place:
+//   Header     magic, version, number of maps
+//   Entry[]    sorted by layout hash
+//   Planet[]   every map's planets, one run per map
+//   uint16_t[] every map's distances, row by row
+//   char[]     every map's name, zero terminated
+// A lookup is a binary search over the entries.
+#ifndef MAP_PACK_H_
+#define MAP_PACK_H_
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+class MapGeometry;
+class PlanetWars;
+
+class MapPack {
+ public:
+  struct Planet {
+    double x;
+    double y;
+    int32_t owner;
+    int32_t num_ships;
+    int32_t growth_rate;
+    int32_t unused;
+  };
+
+  MapPack();
+  ~MapPack();
+
+  // Maps the pack in path. Returns false, leaving the pack empty, if the
+  // file is missing or is not a pack.
+  bool Open(const std::string& path);
+  void Close();
+
+  int NumMaps() const { return header_ ? header_->num_maps : 0; }
+
+  // The map with the given layout hash, or -1.
+  int Find(uint64_t layout_hash) const;
+
+  uint64_t LayoutHash(int map) const { return entries_[map].layout_hash; }
+  int NumPlanets(int map) const { return entries_[map].num_planets; }
+  int MaxDistance(int map) const { return entries_[map].max_distance; }
+
+  // The map's file name without its directory, e.g. "map7.txt".
+  const char *Name(int map) const { return At<char>(entries_[map].name); }
+
+  // The map's planets as the map file starts them.
+  const Planet *Planets(int map) const {
+    return At<Planet>(entries_[map].planets);
+  }
+
+  // Same as MapGeometry::Distance().
+  int Distance(int map, int source_planet, int destination_planet) const {
+    return At<uint16_t>(entries_[map].distances)
+        [source_planet * NumPlanets(map) + destination_planet];
+  }
+
+  // The distances between every pair of planets, row by row.
+  const uint16_t *Distances(int map) const {
+    return At<uint16_t>(entries_[map].distances);
+  }
+
+  // Writes the maps in the files named by paths to path as a pack. Returns
+  // false, naming the culprit in error, if a map cannot be read or two
+  // maps have the same layout, or on an I/O error.
+  static bool Write(const std::string& path,
+                    const std::vector<std::string>& paths, std::string *error);
+
+ private:
+  struct Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t num_maps;
+    uint64_t size;
+  };
+
+  // Offsets are in bytes from the start of the file.
+  struct Entry {
+    uint64_t layout_hash;
+    uint32_t num_planets;
+    uint32_t max_distance;
+    uint64_t planets;
+    uint64_t distances;
+    uint64_t name;
+  };
+
+  template <class T>
+  const T *At(uint64_t offset) const {
+    return reinterpret_cast<const T *>(static_cast<const char *>(data_) +
+                                       offset);
+  }
+
+  void *data_;
+  size_t size_;
+  const Header *header_;
+  const Entry *entries_;
+
+  MapPack(const MapPack&);
+  void operator=(const MapPack&);
+};
+
+#endif
@@ -34,10 +34,26 @@
   Not a winning strategy, but interesting.
  **/
 
+#include <cmath>
+#include <cstring>
 #include <iostream>
+#include <poll.h>
+#include <sstream>
+#include <thread>
+#include <unistd.h>
 using namespace std;
 
 #include "PlanetWars.h"
+#include "Params.h"
+#include "GameState.h"
+#include "Endgame.h"
+#include "TranspositionTable.h"
+#include "ThreadPool.h"
+#include "Selection.h"
+#include "OpeningBook.h"
+#include "FleetTracker.h"
+#include "MapPack.h"
+#include "PerfCounters.h"
 
 // #define PLANET_DEBUG 1
 
@@ -47,7 +63,14 @@ ofstream debugfile;
 #endif
 
 int turn = 0;
-int buffer = 2;
+Params params;
+MapGeometry geometry;
+FixedStateKind state_kind = kDynamicState;
+OpeningBook book;
+MapPack maps;
+PerfProfile profile;
+FleetTracker tracker;
+TranspositionTable table(16);
 
 class Move {
 public:
@@ -64,6 +87,11 @@ public:
     int growth;
     bool wait;
 
+    // Where the action was generated: its wait horizon and whether it came
+    // from the defensive pass.
+    int horizon;
+    bool defensive;
+
     int maxDistance() const {
         int d = 0;
         for (uint i = 0; i < moves.size(); ++i)
@@ -104,244 +132,688 @@ bool actions_sort (Action action1, Action action2) {
     return ((float)investment1/(action1m+1)) < ((float)investment2/(action2m+1));
 }
 
-int neighbors_destination;
-bool neighbors_sort(Planet i, Planet j) {
-    int id = i.pw->Distance(i.PlanetID(), neighbors_destination);
-    int jd = j.pw->Distance(j.PlanetID(), neighbors_destination);
-    return id < jd;
+// The order GenerateActions() produces actions in.
+bool actions_order(const Action& action1, const Action& action2) {
+    if (action1.horizon != action2.horizon)
+        return action1.horizon < action2.horizon;
+    if (action1.defensive != action2.defensive)
+        return action2.defensive;
+    return action1.planet_id < action2.planet_id;
 }
 
-void DoTurn(const PlanetWars& pw) {
-#ifdef PLANET_DEBUG
-    debugfile << "Turn: " << turn;
-    for (int i = 0; i < 3; ++i)
-        debugfile << " " << i << ":" << pw.GrowthRate(i);
-    debugfile << std::endl;
-#endif
+// One of our planets that can help with an action, with what it has before
+// any wait. Every wait horizon of the action starts from the same list.
+struct Source {
+    int planet;
+    int ships;
+    int growth;
+    int distance;
+};
 
-    const std::vector<Planet> my_planets = pw.MyPlanets();
-    const std::vector<Planet> planets = pw.Planets();
+// Adds our planets next nearest to planet_id to sources, which holds the
+// nearest so far, about doubling it. Most actions are settled by the first
+// few, so they are looked up as needed rather than all at once. Returns
+// false if there are no more.
+bool MoreSources(const PlanetWars& pw, int planet_id, std::vector<Source>& sources) {
+    const uint found = sources.size();
+    std::vector<int> mine;
+    pw.NearestPlanets(planet_id, std::max(16, 2 * (int)found), SpatialIndex::kMine, &mine);
+    for (uint j = found; j < mine.size(); ++j) {
+        const Planet& n = pw.GetPlanet(mine[j]);
+        Source source = { n.PlanetID(), pw.real_ship_count(n.PlanetID()),
+                          n.GrowthRate(), pw.Distance(n.PlanetID(), planet_id) };
+        sources.push_back(source);
+    }
+    return sources.size() > found;
+}
 
-    const std::vector<Planet> enemy_planets = pw.EnemyPlanets();
-    if (my_planets.size() == 1 && enemy_planets.size() == 1 && pw.EnemyFleets().size() == 0)
+// Works out an attack on planet p on turn game_turn for every wait horizon
+// below horizons, appending one action per horizon that has one.
+void OffensiveActions(const PlanetWars& pw, const Planet& p, int game_turn, int horizons,
+                      std::vector<Action>& actions) {
+    int required = pw.real_attack_count(p.PlanetID()) + params.attack_margin;
+    // Owned by someone else
+    if (p.Owner() > 1) {
+        //action.growth *= 2;
         return;
-
-    /*    
-    const std::vector<Planet> enemy_planets = pw.EnemyPlanets();
-    int average_enemy_size = 0;
-    for (uint i = 0; i < enemy_planets.size(); ++i)
-        average_enemy_size += enemy_planets[i].NumShips();
-    average_enemy_size /= enemy_planets.size();
-    if (not_my_planets.size() > 1) {
-        buffer = 0;
-        for (uint i = 0; i < not_my_planets.size(); ++i)
-            buffer += not_my_planets[i].NumShips();
-        buffer /= (not_my_planets.size() * 3 + 1);
-        buffer = std::max(2, buffer);
-        buffer = std::min(5, buffer);
     }
-*/
-    std::vector<Fleet> not_my_fleets = pw.EnemyFleets();
-    sort (not_my_fleets.begin(), not_my_fleets.end(), attacking_fleet_sort);
-
-    std::vector<Planet> neighbors = my_planets;
-
 
-    // Offensive Actions
-    std::vector<Action> actions;
-    for (int t = 0; t < 3; ++t) {
-    for (uint i = 0; i < planets.size(); ++i) {
-        const Planet& p = planets[i];
-        if (p.Owner() == 1)
-            continue;
+    // Owned by no one but under attack: the attackers have to get through
+    // the growth the planet makes until they land, of which we count a turn
+    // less for each turn we wait.
+    int wait_cost = 0;
+    if (p.Owner() == 0) {
+        int attackingStrength = pw.UnderAttack(p.PlanetID());
+        if (attackingStrength > 0) {
+            attackingStrength -= p.GrowthRate() * pw.UnderAttackDistance(p.PlanetID());
+            required += attackingStrength;
+            wait_cost = p.GrowthRate();
+        }
+    }
 
-        int required = pw.real_attack_count(p.PlanetID()) + 2;
-        // if we are already going to that planet don't bother
-        if (p.Owner() > 1 && required <= 2)
+    // No move can send more than a planet has after t turns of growth, so
+    // there is no point looking if all of them together are not enough.
+    // Past the longest distance every planet counts, and the bound grows
+    // by the same amount each turn.
+    const int strength = pw.Strength(1, p.PlanetID(), pw.MaxDistance());
+    const int strength_step =
+        pw.Strength(1, p.PlanetID(), pw.MaxDistance() + 1) - strength;
+
+    std::vector<Source> sources;
+    for (int t = 0; t < horizons; ++t) {
+        int needed = required + t * wait_cost;
+        if (needed > strength + t * strength_step)
             continue;
 
-        neighbors_destination = p.PlanetID();
-        sort(neighbors.begin(), neighbors.end(), neighbors_sort);
-
         Action action;
-        action.planet_id = neighbors_destination;
+        action.planet_id = p.PlanetID();
         action.growth = p.GrowthRate();
         action.wait = t > 0;
+        action.horizon = t;
+        action.defensive = false;
 
         int offense = 0;
-
-        // Owned by someone else
-        if (p.Owner() > 1) {
-            //action.growth *= 2;
-            continue;
-
-        }
-        // Owned by no one
-        if (p.Owner() == 0) {
-            // but under attack
-            int attackingStrength = pw.UnderAttack(p.PlanetID());
-            if (attackingStrength > 0) {
-                attackingStrength -= p.GrowthRate() * (pw.UnderAttackDistance(p.PlanetID()) - t);
-                required += attackingStrength;
-            }
-        }
-#ifdef PLANET_DEBUG
-        debugfile << "o:" << p.Owner() << " g:" << action.growth << " r:" << required << " s:" << p.NumShips() << endl;
-#endif
-        for (uint j = 0; j < neighbors.size(); ++j) {
-            const Planet& n = neighbors[j];
+        for (uint j = 0; j < sources.size() || MoreSources(pw, p.PlanetID(), sources); ++j) {
+            const Source& source = sources[j];
             Move move;
-            move.source = n.PlanetID();
-            int have = pw.real_ship_count(move.source) + t * n.GrowthRate();
-            move.distance = pw.Distance(move.source, action.planet_id);
-            move.ships = std::min(required, have - buffer);
-            int leftOver = have - buffer - move.ships;
-            int TravelBonus = 0;
-            if (p.Owner() > 1) {
-                int currentDistance = action.maxDistance();
-                if (move.distance > currentDistance) {
-                    TravelBonus += move.distance - currentDistance;
-                    TravelBonus *= p.GrowthRate();
-                    int whatICanSend = std::min(leftOver, TravelBonus);
-                    move.ships += whatICanSend;
-                    TravelBonus -= whatICanSend;
-                }
-            }
-            //debugfile <<  "\tr" << required << "s" << move.ships <<endl;
-            if (move.ships > 0 && move.ships >= std::min(required, 7)) {
-                // Assume they will defend themselves
-                if (p.Owner() > 1)
-                    offense += TravelBonus;
+            move.source = source.planet;
+            int have = source.ships + t * source.growth;
+            move.distance = source.distance;
+            move.ships = std::min(needed, have - params.buffer);
+            if (move.ships > 0 && move.ships >= std::min(needed, params.min_move)) {
                 action.moves.push_back(move);
-                required -= move.ships;
-                if (required < 0)
-                    offense += required;
+                needed -= move.ships;
+                if (needed < 0)
+                    offense += needed;
             }
-            if (required <= 0 && offense <= 0)
+            if (needed <= 0 && offense <= 0)
                 break;
         }
-#ifdef PLANET_DEBUG
-        debugfile << "\t" << action.moves.size() << " " << required << endl;
-#endif
         // Don't attempt a long term distnace attack if it isn't 100%
         if (offense > 0) {
-            if (action.maxDistance() > turn + 5)
+            if (action.maxDistance() > game_turn + params.distance_slack)
                 action.moves.clear();
         }
 
-        if (action.moves.size() > 0 && required <= 0)
+        if (action.moves.size() > 0 && needed <= 0)
             actions.push_back(action);
     }
- 
-#ifdef PLANET_DEBUG
-    debugfile << "attack: " << actions.size() << std::endl;
-#endif
+}
 
-    // Defensive Actions
-    for (uint i = 0; i < my_planets.size(); ++i) {
-        Planet p = my_planets[i];
-        int help_id = p.PlanetID();
-        int real_ship_count = pw.real_ship_count(help_id);
-        if (real_ship_count > 0)
-            continue;
-        int required = real_ship_count * -1;
-        int time_left = pw.time_left(help_id);
+// Works out how to reinforce our planet p for every wait horizon below
+// horizons, appending one action per horizon that has one. Nothing is
+// appended if it needs no help.
+void DefensiveActions(const PlanetWars& pw, const Planet& p, int horizons,
+                      std::vector<Action>& actions) {
+    int help_id = p.PlanetID();
+    int real_ship_count = pw.real_ship_count(help_id);
+    if (real_ship_count > 0)
+        return;
+    int required = real_ship_count * -1;
+    int time_left = pw.time_left(help_id);
+    // Help has to arrive in time.
+    if (pw.Reach(1, help_id) > time_left)
+        return;
 
-        neighbors_destination = p.PlanetID();
-        sort(neighbors.begin(), neighbors.end(), neighbors_sort);
+    std::vector<Source> sources;
+    std::vector<int> mine;
+    pw.PlanetsWithin(help_id, time_left, SpatialIndex::kMine, &mine);
+    for (uint j = 0; j < mine.size(); ++j) {
+        const Planet& n = pw.GetPlanet(mine[j]);
+        if (n.PlanetID() == help_id)
+            continue;
+        if (n.NumShips() < params.defend_min_ships)
+            continue;
+        Source source = { n.PlanetID(), pw.real_ship_count(n.PlanetID()),
+                          n.GrowthRate(), pw.Distance(n.PlanetID(), help_id) };
+        sources.push_back(source);
+    }
+    if (sources.empty())
+        return;
 
+    for (int t = 0; t < horizons; ++t) {
         Action action;
-        action.planet_id = neighbors_destination;
+        action.planet_id = help_id;
         action.growth = p.GrowthRate() * 2;
         action.wait = t > 0;
+        action.horizon = t;
+        action.defensive = true;
 
-        for (uint j = 0; j < neighbors.size(); ++j) {
-            Planet n = neighbors[j];
-            if (n.PlanetID() == help_id)
-                continue;
-            int distance_away = pw.Distance(help_id, n.PlanetID());
-            if (time_left < distance_away)
-                continue;
-            if (n.NumShips() < 4)
-                continue;
-
+        int needed = required;
+        for (uint j = 0; j < sources.size(); ++j) {
+            const Source& source = sources[j];
             Move move;
-            move.source = n.PlanetID();
-            int have = pw.real_ship_count(move.source) + t * n.GrowthRate();
-            move.ships = std::min(required, have - 2);
-            move.distance = pw.Distance(move.source, action.planet_id);
+            move.source = source.planet;
+            int have = source.ships + t * source.growth;
+            move.ships = std::min(needed, have - params.defend_buffer);
+            move.distance = source.distance;
 
-            if (move.ships > 3) {
+            if (move.ships > params.defend_min_move) {
                 action.moves.push_back(move);
-                required -= move.ships;
+                needed -= move.ships;
             }
-            if (required <= 0)
+            if (needed <= 0)
                 break;
         }
-        if (action.moves.size() > 0 && required <= 0)
+        if (action.moves.size() > 0 && needed <= 0)
             actions.push_back(action);
     }
-#ifdef PLANET_DEBUG
-    debugfile << "defense: " << actions.size() << std::endl;
-#endif
+}
+
+ThreadPool pool;
+
+// A target to generate actions for, at every wait horizon.
+struct ActionTask {
+    bool defensive;
+    int planet;
+};
+
+// Works out the offensive and defensive actions of turn game_turn for every
+// wait horizon. When targets is given, only the planets it marks are
+// considered. Each target is one task on the thread pool, which works out
+// what its horizons share once, and the results are appended in
+// actions_order, whatever the number of threads. The turn is passed in
+// rather than read from the global, since Speculation calls this while
+// main() moves on to the next turn.
+void GenerateActions(const PlanetWars& pw, int game_turn, const std::vector<bool> *targets,
+                     std::vector<Action>& actions) {
+    const std::vector<Planet> my_planets = pw.MyPlanets();
+    const std::vector<Planet> planets = pw.Planets();
+
+    std::vector<ActionTask> tasks;
+    for (uint i = 0; i < planets.size(); ++i) {
+        // Only neutral planets are attacked; OffensiveActions() turns
+        // down enemy planets anyway.
+        if (planets[i].Owner() != 0)
+            continue;
+        if (targets && !(*targets)[planets[i].PlanetID()])
+            continue;
+        ActionTask task = { false, (int)i };
+        tasks.push_back(task);
+    }
+    for (uint i = 0; i < my_planets.size(); ++i) {
+        if (targets && !(*targets)[my_planets[i].PlanetID()])
+            continue;
+        ActionTask task = { true, (int)i };
+        tasks.push_back(task);
     }
 
-    sort (actions.begin(), actions.end(), actions_sort);
+    std::vector<std::vector<Action> > found(pool.NumWorkers());
+    pool.Run(tasks.size(), [&](int i, int worker) {
+        const ActionTask& task = tasks[i];
+        if (task.defensive)
+            DefensiveActions(pw, my_planets[task.planet], params.wait_horizons, found[worker]);
+        else
+            OffensiveActions(pw, planets[task.planet], game_turn, params.wait_horizons, found[worker]);
+    });
+
+    const size_t first = actions.size();
+    for (uint w = 0; w < found.size(); ++w)
+        actions.insert(actions.end(), found[w].begin(), found[w].end());
+    stable_sort(actions.begin() + first, actions.end(), actions_order);
 #ifdef PLANET_DEBUG
-    debugfile << "sorted: " << endl;
+    debugfile << "actions: " << actions.size() - first << std::endl;
 #endif
-    std::vector<int> destinations;
+}
+
+// Reads a whole state into pw the way main() reads the engine, with the
+// enemy fleets expected to leave this turn (see FleetTracker.h).
+void ParseState(PlanetWars& pw, const std::string& text, const std::vector<Fleet>& expected) {
+    pw.BeginState();
+    for (size_t begin = 0, end; begin < text.size(); begin = end + 1) {
+        end = text.find('\n', begin);
+        if (end == std::string::npos)
+            end = text.size();
+        pw.ParseLine(text.data() + begin, end - begin);
+    }
+    pw.SetPredictedFleets(expected);
+    pw.EndState();
+}
+
+// True if a and b are the same predicted fleet.
+bool SamePrediction(const Fleet& a, const Fleet& b) {
+    return a.Owner() == b.Owner() && a.NumShips() == b.NumShips() &&
+           a.SourcePlanet() == b.SourcePlanet() && a.DestinationPlanet() == b.DestinationPlanet();
+}
+
+// Marks the destination of every fleet of a that b does not have.
+void MarkPredictions(const std::vector<Fleet>& a, const std::vector<Fleet>& b, std::vector<bool>& targets) {
+    for (uint i = 0; i < a.size(); ++i) {
+        bool found = false;
+        for (uint j = 0; j < b.size() && !found; ++j)
+            found = SamePrediction(a[i], b[j]);
+        if (!found && a[i].DestinationPlanet() < (int)targets.size())
+            targets[a[i].DestinationPlanet()] = true;
+    }
+}
+
+// Plans the next turn in the background while the enemy is thinking. The
+// state we expect is this turn's state after our orders, the enemy orders
+// we predicted and one turn of movement. The plan also counts the fleets
+// the tracker will predict for that turn, as the real turn would. When the
+// real state arrives, the actions for every planet that neither the enemy
+// nor a changed prediction touched are reused as they are.
+class Speculation {
+public:
+    Speculation() : running(false), planned_turn(0) {}
+    ~Speculation() { Wait(); }
+
+    // Starts planning game turn next_turn, the turn after state, in which we
+    // issued orders and the enemy is expected to launch enemy_orders. The
+    // worker only reads what it is given here, params and geometry, which
+    // do not change after turn 0, so main() can carry on with its globals.
+    void Start(const GameState& state, int next_turn, const std::vector<Fleet>& orders,
+               const std::vector<Fleet>& enemy_orders) {
+        Wait();
+        planned_turn = next_turn;
+        predicted.CopyFrom(state);
+        issued = orders;
+        expected = enemy_orders;
+        if (params.predict_rate > 0)
+            habits = tracker;
+        running = true;
+        worker = std::thread(&Speculation::Plan, this);
+    }
+
+    // Waits for the background planning and fills actions with every
+    // predicted action that still applies to state, in which the enemy is
+    // expected to launch enemy_orders. targets marks the planets whose
+    // actions still have to be generated. Returns false if nothing could be
+    // reused.
+    bool Reuse(const GameState& state, const std::vector<Fleet>& enemy_orders,
+               std::vector<Action>& actions, std::vector<bool>& targets) {
+        if (!running)
+            return false;
+        Wait();
+        // A prediction counts towards its destination's enemy fleets, so a
+        // planet with a prediction the plan did not make, or without one it
+        // did, has to be planned again.
+        predicted.ChangedPlanets(state, targets);
+        MarkPredictions(enemy_orders, planned_orders, targets);
+        MarkPredictions(planned_orders, enemy_orders, targets);
+        // Every action depends on the ships of all of our planets.
+        for (int i = 0; i < state.NumPlanets(); ++i) {
+            if (targets[i] && (state.GetPlanet(i).owner == 1 || predicted.GetPlanet(i).owner == 1))
+                return false;
+        }
+        for (uint i = 0; i < planned.size(); ++i) {
+            if (!targets[planned[i].planet_id])
+                actions.push_back(planned[i]);
+        }
+        return true;
+    }
+
+    // Drops the plan, for a turn that is not speculated on.
+    void Stop() {
+        Wait();
+        running = false;
+    }
+
+private:
+    void Wait() {
+        if (worker.joinable())
+            worker.join();
+    }
+
+    void Plan() {
+        for (uint i = 0; i < issued.size(); ++i)
+            predicted.IssueOrder(geometry, issued[i].SourcePlanet(), issued[i].DestinationPlanet(), issued[i].NumShips());
+        for (uint i = 0; i < expected.size(); ++i) {
+            const Fleet& f = expected[i];
+            const PlanetState& source = predicted.GetPlanet(f.SourcePlanet());
+            if (source.owner == f.Owner() && source.num_ships >= f.NumShips())
+                predicted.IssueOrder(geometry, f.SourcePlanet(), f.DestinationPlanet(), f.NumShips());
+        }
+        predicted.AdvanceTurn(geometry);
+        const std::string text = predicted.ToString(geometry);
+        planned_orders.clear();
+        ParseState(pw, text, planned_orders);
+        // The habits do not change before the real turn has been seen, so
+        // these are the fleets main() will predict if the enemy launches
+        // what we expected.
+        if (params.predict_rate > 0) {
+            habits.Predict(pw, params.predict_rate, &planned_orders);
+            if (!planned_orders.empty())
+                ParseState(pw, text, planned_orders);
+        }
+        planned.clear();
+        GenerateActions(pw, planned_turn, NULL, planned);
+    }
+
+    bool running;
+    std::thread worker;
+    int planned_turn;
+    GameState predicted;
+    std::vector<Fleet> issued;
+    std::vector<Fleet> expected;
+    // The tracker as of the turn the plan starts from, and the enemy
+    // orders it predicts for the planned turn.
+    FleetTracker habits;
+    std::vector<Fleet> planned_orders;
+    std::vector<Action> planned;
+    // Kept from one plan to the next, so its influence map only takes in
+    // what changed.
+    PlanetWars pw;
+};
+
+Speculation speculation;
+ActionSelector selector;
+
+// A book position matches on a 64-bit hash, so check its orders can be
+// carried out before trusting them.
+bool BookOrdersValid(const PlanetWars& pw, const OpeningBook::Order *orders, int num_orders) {
+    std::vector<int> ships(pw.NumPlanets());
+    for (int i = 0; i < pw.NumPlanets(); ++i)
+        ships[i] = pw.GetPlanet(i).Owner() == 1 ? pw.GetPlanet(i).NumShips() : 0;
+    for (int i = 0; i < num_orders; ++i) {
+        const OpeningBook::Order& order = orders[i];
+        if (order.source_planet >= pw.NumPlanets() || order.destination_planet >= pw.NumPlanets() ||
+            order.source_planet == order.destination_planet || order.num_ships == 0 ||
+            order.num_ships > ships[order.source_planet])
+            return false;
+        ships[order.source_planet] -= order.num_ships;
+    }
+    return true;
+}
+
+// Picks the sorted actions to carry out, searching for at most budget_ms.
+void SelectActions(const PlanetWars& pw, const std::vector<Action>& actions,
+                   int budget_ms, std::vector<int> *chosen) {
+    // Each source can spare its real ship count, plus the growth it makes
+    // while an action waits.
+    selector.Reset(pw.NumPlanets());
+    for (int i = 0; i < pw.NumPlanets(); ++i)
+        selector.SetCapacity(i, pw.real_ship_count(i));
     for (uint i = 0; i < actions.size(); ++i) {
         const Action &action = actions[i];
 #ifdef PLANET_DEBUG
         debugfile << "Action: " << "w" << action.wait << " i" << action.investment() << "\tsource:" << action.planet_id << "\tdist:" << action.maxDistance() << "\tships:" << action.ships() << "\tgrowth: " << action.growth << "\tmoves: " << action.moves.size() << "\tisvalid:" << action.isValid(pw) << std::endl;
 #endif
-        if (!action.isValid(pw))
-            continue;
+        int payoff = std::max(0, params.select_horizon - action.investment());
+        selector.AddCandidate(action.planet_id, action.growth * payoff + 1);
+        for (uint j = 0; j < action.moves.size(); ++j) {
+            const Move &move = action.moves[j];
+            int bonus = action.wait * pw.GetPlanet(move.source).GrowthRate();
+            selector.AddUse(move.source, move.ships - bonus + 1, move.ships);
+        }
+    }
+    selector.Solve(params.select_nodes, budget_ms, chosen);
+}
 
-        int destination = action.planet_id;
-        if (std::find(destinations.begin(), destinations.end(), destination) != destinations.end())
-            continue;
+void DoTurn(const PlanetWars& pw, const GameState& state, const std::vector<Fleet>& predicted) {
+#ifdef PLANET_DEBUG
+    debugfile << "Turn: " << turn;
+    for (int i = 0; i < 3; ++i)
+        debugfile << " " << i << ":" << pw.GrowthRate(i);
+    debugfile << std::endl;
+#endif
+
+    // Positions the opening book was built for are played from it. The book
+    // and the endgame search only see state, so they sit out turns it does
+    // not hold exactly (see GameState::Exact()).
+    const OpeningBook::Order *book_orders;
+    int num_book_orders;
+    if (state.Exact() && book.Lookup(geometry.LayoutHash(), state.Hash(), &book_orders, &num_book_orders) &&
+        BookOrdersValid(pw, book_orders, num_book_orders)) {
+        for (int i = 0; i < num_book_orders; ++i) {
+            const OpeningBook::Order& order = book_orders[i];
+            pw.IssueOrder(order.source_planet, order.destination_planet, order.num_ships);
+        }
+        profile.Mark("book");
+        return;
+    }
+    profile.Mark("book");
+
+    // With only a few planets left, search the rest of the game instead.
+    if (state.Exact() && EndgameSolver::Applies(state, geometry, params)) {
+        EndgameSolver solver(geometry, params, &table, state_kind);
+        EndgameSolver::Result result;
+        if (solver.Solve(state, params.max_turns - turn, params.endgame_ms, &result)) {
 #ifdef PLANET_DEBUG
-        debugfile << "\t^^ Taken" << endl;
+            debugfile << "endgame: depth " << result.depth << " score " << result.score
+                      << (result.played_out ? " played out" : "") << endl;
 #endif
+            for (uint i = 0; i < result.orders.size(); ++i) {
+                const EndgameSolver::Order& order = result.orders[i];
+                pw.IssueOrder(order.source_planet, order.destination_planet, order.num_ships);
+            }
+            profile.Mark("endgame");
+            return;
+        }
+    }
+    profile.Mark("endgame");
+
+    const std::vector<Planet> my_planets = pw.MyPlanets();
+    const std::vector<Planet> enemy_planets = pw.EnemyPlanets();
+    if (my_planets.size() == 1 && enemy_planets.size() == 1 && pw.EnemyFleets().size() == 0)
+        return;
+
+    /*    
+    const std::vector<Planet> enemy_planets = pw.EnemyPlanets();
+    int average_enemy_size = 0;
+    for (uint i = 0; i < enemy_planets.size(); ++i)
+        average_enemy_size += enemy_planets[i].NumShips();
+    average_enemy_size /= enemy_planets.size();
+    if (not_my_planets.size() > 1) {
+        buffer = 0;
+        for (uint i = 0; i < not_my_planets.size(); ++i)
+            buffer += not_my_planets[i].NumShips();
+        buffer /= (not_my_planets.size() * 3 + 1);
+        buffer = std::max(2, buffer);
+        buffer = std::min(5, buffer);
+    }
+*/
+    std::vector<Fleet> not_my_fleets = pw.EnemyFleets();
+    sort (not_my_fleets.begin(), not_my_fleets.end(), attacking_fleet_sort);
+
+    std::vector<Action> actions;
+    std::vector<bool> targets;
+    if (speculation.Reuse(state, predicted, actions, targets)) {
+        GenerateActions(pw, turn, &targets, actions);
+        stable_sort(actions.begin(), actions.end(), actions_order);
+    } else {
+        GenerateActions(pw, turn, NULL, actions);
+    }
+    profile.Mark("generate");
+#ifdef PLANET_DEBUG
+    debugfile << "regenerated: " << std::count(targets.begin(), targets.end(), true) << endl;
+#endif
+
+    sort (actions.begin(), actions.end(), actions_sort);
+    profile.Mark("sort");
+#ifdef PLANET_DEBUG
+    debugfile << "sorted: " << endl;
+#endif
+    std::vector<int> chosen;
+    SelectActions(pw, actions, params.select_ms, &chosen);
+    profile.Mark("select");
+#ifdef PLANET_DEBUG
+    debugfile << "selected: " << chosen.size() << " nodes " << selector.Nodes()
+              << (selector.Complete() ? "" : " (budget)") << endl;
+#endif
+
+    for (uint i = 0; i < chosen.size(); ++i) {
+        const Action &action = actions[chosen[i]];
         for (uint j = 0; j < action.moves.size(); ++j) {
             if (action.wait == false) {
-                pw.IssueOrder(action.moves[j].source, destination, action.moves[j].ships);
+                pw.IssueOrder(action.moves[j].source, action.planet_id, action.moves[j].ships);
             } else {
                 pw.removeShips(action.moves[j].source, action.moves[j].ships);
             }
         }
-        destinations.push_back(destination);
     }
+    profile.Mark("orders");
 #ifdef PLANET_DEBUG
     debugfile << endl;
 #endif
 }
 
+// True if the engine has sent something that has not been read yet.
+bool InputPending() {
+    struct pollfd fd = { STDIN_FILENO, POLLIN, 0 };
+    return poll(&fd, 1, 0) > 0;
+}
+
+// A made-up position in mid-game for Warmup(): the first map of the pack, or
+// planets on a circle without one, shared out among the players, with
+// fleets on the way.
+std::string WarmupState() {
+    std::vector<MapPack::Planet> planets;
+    if (maps.NumMaps() > 0) {
+        planets.assign(maps.Planets(0), maps.Planets(0) + maps.NumPlanets(0));
+    } else {
+        for (int i = 0; i < 23; ++i) {
+            const double angle = 2 * M_PI * i / 23;
+            MapPack::Planet planet = { 12 + 10 * cos(angle), 12 + 10 * sin(angle), 0, 10 + i, 1 + i % 5, 0 };
+            planets.push_back(planet);
+        }
+    }
+    std::stringstream text;
+    for (uint i = 0; i < planets.size(); ++i)
+        text << "P " << planets[i].x << " " << planets[i].y << " " << i % 3 << " "
+             << planets[i].num_ships << " " << planets[i].growth_rate << "\n";
+    for (uint i = 0; i < planets.size(); ++i) {
+        const uint j = (i + 1) % planets.size();
+        const int trip = (int)ceil(hypot(planets[i].x - planets[j].x, planets[i].y - planets[j].y));
+        if (i % 3 != 0)
+            text << "F " << i % 3 << " " << 5 + i << " " << i << " " << j << " " << trip << " "
+                 << (trip + 1) / 2 << "\n";
+    }
+    return text.str();
+}
+
+// Plans a made-up turn before the first "go", so that the first real turn
+// does not pay for waking the worker threads, faulting in the tables and
+// growing pw's and the planner's buffers. Nothing is written to the engine
+// and nothing the made-up game leaves behind is kept. Each step is skipped
+// if the engine is already waiting for us.
+void Warmup(PlanetWars& pw) {
+    const int kBudgetMs = 5;
+    if (InputPending())
+        return;
+    // Read the way main() reads the engine, so the same storage grows.
+    ParseState(pw, WarmupState(), std::vector<Fleet>());
+    geometry = MapGeometry(pw);
+    state_kind = ChooseFixedState(geometry.NumPlanets());
+    const GameState state(pw);
+    std::vector<Action> actions;
+    GenerateActions(pw, 0, NULL, actions);
+    sort (actions.begin(), actions.end(), actions_sort);
+    std::vector<int> chosen;
+    if (!InputPending())
+        SelectActions(pw, actions, std::min(params.select_ms, kBudgetMs), &chosen);
+    if (!InputPending()) {
+        EndgameSolver solver(geometry, params, &table, state_kind);
+        EndgameSolver::Result result;
+        solver.Solve(state, params.max_turns, std::min(params.endgame_ms, kBudgetMs), &result);
+    }
+
+    // Turn 0 works the real map out again.
+    table.Clear();
+    geometry = MapGeometry();
+    state_kind = kDynamicState;
+    pw.BeginState();
+}
+
 // This is just the main game loop that takes care of communicating with the
-// game engine for you. You don't have to understand or change the code below.
-int main(int /*argc*/, char * /*argv*/ []) {
+// game engine for you. Any other arguments are name=value overrides for
+// Params.
+int main(int argc, char *argv[]) {
 #ifdef PLANET_DEBUG
   debugfile.open ("stderr.txt");
 #endif
-
-  std::string current_line;
-  std::string map_data;
+  // book=FILE names the opening book and maps=FILE the map pack; book= and
+  // maps= play without them. perf=FILE writes the time and hardware
+  // counters of every planner phase to FILE (see PerfCounters.h).
+  std::string book_file = "opening.book";
+  std::string maps_file = "maps.pack";
+  std::string perf_file;
+  for (int i = 1; i < argc; ++i) {
+    if (strncmp(argv[i], "book=", 5) == 0)
+      book_file = argv[i] + 5;
+    else if (strncmp(argv[i], "maps=", 5) == 0)
+      maps_file = argv[i] + 5;
+    else if (strncmp(argv[i], "perf=", 5) == 0)
+      perf_file = argv[i] + 5;
+    else if (!params.Set(argv[i]))
+      std::cerr << "Ignoring unknown parameter: " << argv[i] << std::endl;
+  }
+  if (!book_file.empty())
+    book.Open(book_file);
+  if (!maps_file.empty())
+    maps.Open(maps_file);
+  if (!perf_file.empty() && !profile.Open(perf_file))
+    std::cerr << "Cannot write " << perf_file << std::endl;
+  pool.Start(params.threads);
+
+  // Each line is parsed straight out of the read buffer as soon as it
+  // arrives, so the state is complete the moment "go" is read.
+  PlanetWars pw;
+  if (params.warmup)
+    Warmup(pw);
+  pw.BeginState();
+  char buffer[1 << 16];
+  size_t used = 0;
+  // Set while the rest of a line too long for the buffer is thrown away.
+  bool skipping = false;
   while (true) {
-    int c = std::cin.get();
-    current_line += (char)c;
-    if (c == '\n') {
-      if (current_line.length() >= 2 && current_line.substr(0, 2) == "go") {
-        PlanetWars pw(map_data);
-        map_data = "";
-		DoTurn(pw);
+    ssize_t n = read(STDIN_FILENO, buffer + used, sizeof(buffer) - used);
+    if (n <= 0)
+      break;
+    used += n;
+    size_t begin = 0;
+    for (size_t i = used - n; i < used; ++i) {
+      if (buffer[i] != '\n')
+        continue;
+      const char *line = buffer + begin;
+      size_t length = i - begin;
+      begin = i + 1;
+      if (skipping) {
+        skipping = false;
+        continue;
+      }
+      if (length >= 2 && line[0] == 'g' && line[1] == 'o') {
+        profile.BeginTurn();
+        tracker.Update(pw);
+        std::vector<Fleet> predicted;
+        if (params.predict_rate > 0)
+          tracker.Predict(pw, params.predict_rate, &predicted);
+        pw.SetPredictedFleets(predicted);
+        pw.EndState();
+        if (turn == 0) {
+            const int map = maps.Find(MapGeometry::HashLayout(pw));
+            if (map >= 0 && maps.NumPlanets(map) == pw.NumPlanets())
+                geometry = MapGeometry(maps, map);
+            else
+                geometry = MapGeometry(pw);
+            state_kind = ChooseFixedState(geometry.NumPlanets());
+        }
+        const GameState state(pw);
+        profile.Mark("state");
+		DoTurn(pw, state, predicted);
 		pw.FinishTurn();
+        profile.Mark("output");
+        profile.EndTurn(turn);
         turn++;
+        if (params.speculate && state.Exact())
+            speculation.Start(state, turn, pw.Orders(), predicted);
+        else
+            speculation.Stop();
+        pw.BeginState();
       } else {
-        map_data += current_line;
+        pw.ParseLine(line, length);
       }
-      current_line = "";
+    }
+    // Keep the start of an unfinished line for the next read. A line that
+    // fills the whole buffer is malformed: it is dropped up to its newline
+    // rather than parsed in pieces.
+    used -= begin;
+    memmove(buffer, buffer + begin, used);
+    if (used == sizeof(buffer)) {
+      if (!skipping)
+        std::cerr << "Ignoring a line longer than " << sizeof(buffer) << " bytes" << std::endl;
+      skipping = true;
+      used = 0;
     }
   }
   return 0;
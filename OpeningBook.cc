@@ -0,0 +1,126 @@
+#include "OpeningBook.h"
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+const char kMagic[8] = { 'P', 'W', 'B', 'O', 'O', 'K', 0, 0 };
+const uint32_t kVersion = 1;
+
+#ifdef MAP_POPULATE
+const int kPopulate = MAP_POPULATE;
+#else
+const int kPopulate = 0;
+#endif
+
+}  // namespace
+
+OpeningBook::OpeningBook()
+    : data_(0), size_(0), header_(0), entries_(0), orders_(0) {
+}
+
+OpeningBook::~OpeningBook() {
+  Close();
+}
+
+bool OpeningBook::Open(const std::string& path) {
+  Close();
+  const int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0)
+    return false;
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(Header)) {
+    close(fd);
+    return false;
+  }
+  // The book is small; faulting it all in now keeps the first lookup from
+  // stopping on page faults.
+  void *data = mmap(0, st.st_size, PROT_READ, MAP_PRIVATE | kPopulate, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED)
+    return false;
+  data_ = data;
+  size_ = st.st_size;
+
+  const Header *header = static_cast<const Header *>(data_);
+  const size_t expected = sizeof(Header) +
+                          (size_t)header->num_entries * sizeof(Entry) +
+                          (size_t)header->num_orders * sizeof(Order);
+  if (memcmp(header->magic, kMagic, sizeof(kMagic)) != 0 ||
+      header->version != kVersion || size_ < expected) {
+    Close();
+    return false;
+  }
+  header_ = header;
+  entries_ = reinterpret_cast<const Entry *>(header_ + 1);
+  orders_ = reinterpret_cast<const Order *>(entries_ + header_->num_entries);
+  return true;
+}
+
+void OpeningBook::Close() {
+  if (data_)
+    munmap(data_, size_);
+  data_ = 0;
+  size_ = 0;
+  header_ = 0;
+  entries_ = 0;
+  orders_ = 0;
+}
+
+bool OpeningBook::Lookup(uint64_t layout, uint64_t position,
+                         const Order **orders, int *num_orders) const {
+  if (!header_)
+    return false;
+  int low = 0, high = header_->num_entries;
+  while (low < high) {
+    const int mid = (low + high) / 2;
+    const Entry& e = entries_[mid];
+    if (e.layout < layout || (e.layout == layout && e.position < position))
+      low = mid + 1;
+    else
+      high = mid;
+  }
+  if (low == (int)header_->num_entries)
+    return false;
+  const Entry& e = entries_[low];
+  if (e.layout != layout || e.position != position ||
+      e.first_order + e.num_orders > header_->num_orders)
+    return false;
+  *orders = orders_ + e.first_order;
+  *num_orders = e.num_orders;
+  return true;
+}
+
+bool OpeningBook::Write(const std::string& path, const Positions& positions) {
+  Header header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, kMagic, sizeof(kMagic));
+  header.version = kVersion;
+  std::vector<Entry> entries;
+  std::vector<Order> orders;
+  for (Positions::const_iterator it = positions.begin();
+       it != positions.end(); ++it) {
+    Entry e = { it->first.first, it->first.second, (uint32_t)orders.size(),
+                (uint32_t)it->second.size() };
+    entries.push_back(e);
+    orders.insert(orders.end(), it->second.begin(), it->second.end());
+  }
+  header.num_entries = entries.size();
+  header.num_orders = orders.size();
+
+  FILE *f = fopen(path.c_str(), "wb");
+  if (!f)
+    return false;
+  bool ok = fwrite(&header, sizeof(header), 1, f) == 1;
+  if (!entries.empty())
+    ok = ok && fwrite(&entries[0], sizeof(Entry), entries.size(), f) ==
+               entries.size();
+  if (!orders.empty())
+    ok = ok && fwrite(&orders[0], sizeof(Order), orders.size(), f) ==
+               orders.size();
+  return fclose(f) == 0 && ok;
+}
@@ -0,0 +1,88 @@
+// Orders for the first turns of known maps, worked out ahead of time by
+// tools/Openings.cc.
+//
+// The book is a cache of the bot's own play, not a deeper search: the
+// orders are whatever the live bot gave when it played itself, only with
+// larger select_nodes and select_ms. On the bundled maps it was checked on,
+// a book built that way gives the same orders live play would, so what it
+// saves is the time of the first turns rather than making better moves.
+// A book only plays better if it is built from a stronger bot or better
+// parameters.
+//
+// A position is keyed by MapGeometry::LayoutHash() and GameState::Hash() of
+// the state as the bot sees it, so the two seats of a map are different
+// positions, and a position the book was not built for (an unknown map, or
+// an opponent that played differently) is simply not found.
+//
+// The file is mapped read-only and used in place:
+//   Header   magic, version, number of entries and orders
+//   Entry[]  sorted by (layout, position)
+//   Order[]  the orders of every entry, one run per entry
+// A lookup is a binary search over the entries.
+#ifndef OPENING_BOOK_H_
+#define OPENING_BOOK_H_
+
+#include <map>
+#include <stdint.h>
+#include <string>
+#include <utility>
+#include <vector>
+
+class OpeningBook {
+ public:
+  struct Order {
+    uint16_t source_planet;
+    uint16_t destination_planet;
+    uint16_t num_ships;
+  };
+
+  // Orders by (layout hash, position hash).
+  typedef std::map<std::pair<uint64_t, uint64_t>, std::vector<Order> >
+      Positions;
+
+  OpeningBook();
+  ~OpeningBook();
+
+  // Maps the book in path. Returns false, leaving the book empty, if the
+  // file is missing or is not a book.
+  bool Open(const std::string& path);
+  void Close();
+
+  int NumPositions() const { return header_ ? header_->num_entries : 0; }
+
+  // Finds the orders for position on the map with the given layout hash.
+  // orders points into the mapped file. An empty run of orders is a book
+  // move too: it means wait.
+  bool Lookup(uint64_t layout, uint64_t position, const Order **orders,
+              int *num_orders) const;
+
+  // Writes positions to path as a book. Returns false on an I/O error.
+  static bool Write(const std::string& path, const Positions& positions);
+
+ private:
+  struct Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t num_entries;
+    uint32_t num_orders;
+    uint32_t unused;
+  };
+
+  struct Entry {
+    uint64_t layout;
+    uint64_t position;
+    uint32_t first_order;
+    uint32_t num_orders;
+  };
+
+  void *data_;
+  size_t size_;
+  const Header *header_;
+  const Entry *entries_;
+  const Order *orders_;
+
+  OpeningBook(const OpeningBook&);
+  void operator=(const OpeningBook&);
+};
+
+#endif
@@ -0,0 +1,97 @@
+#include "Params.h"
+#include <cstdlib>
+#include <sstream>
+
+const ParamInfo kParamTable[] = {
+  { "buffer",                &Params::buffer,                 0, 20,      true },
+  { "attack_margin",         &Params::attack_margin,          0, 20,      true },
+  { "min_move",              &Params::min_move,               1, 50,      true },
+  { "distance_slack",        &Params::distance_slack,         0, 50,      true },
+  { "defend_min_ships",      &Params::defend_min_ships,       0, 50,      true },
+  { "defend_min_move",       &Params::defend_min_move,        0, 50,      true },
+  { "defend_buffer",         &Params::defend_buffer,          0, 20,      true },
+  { "wait_horizons",         &Params::wait_horizons,          1, 20,      true },
+  { "select_nodes",          &Params::select_nodes,           0, 1000000, false },
+  { "select_ms",             &Params::select_ms,              0, 1000,    false },
+  { "select_horizon",        &Params::select_horizon,         1, 200,     true },
+  { "predict_rate",          &Params::predict_rate,           0, 100,     true },
+  { "endgame_planets",       &Params::endgame_planets,        0, 30,      true },
+  { "endgame_fleets",        &Params::endgame_fleets,         0, 100,     true },
+  { "endgame_ms",            &Params::endgame_ms,             0, 900,     false },
+  { "endgame_depth",         &Params::endgame_depth,          1, 100,     true },
+  { "endgame_branching",     &Params::endgame_branching,      1, 20,      true },
+  { "endgame_growth_turns",  &Params::endgame_growth_turns,   0, 100,     true },
+  { "eval_growth",           &Params::eval_growth,            0, 1000,    true },
+  { "eval_ships",            &Params::eval_ships,             0, 1000,    true },
+  { "eval_fleets",           &Params::eval_fleets,            0, 1000,    true },
+  { "eval_pressure",         &Params::eval_pressure,          0, 1000,    true },
+  { "eval_projected",        &Params::eval_projected,         0, 1000,    true },
+  { "max_turns",             &Params::max_turns,              1, 1000,    false },
+  { "speculate",             &Params::speculate,              0, 1,       false },
+  { "warmup",                &Params::warmup,                 0, 1,       false },
+  { "threads",               &Params::threads,                1, 64,      false },
+};
+
+const int kNumParams = sizeof(kParamTable) / sizeof(kParamTable[0]);
+
+Params::Params()
+    : buffer(2),
+      attack_margin(2),
+      min_move(7),
+      distance_slack(5),
+      defend_min_ships(4),
+      defend_min_move(3),
+      defend_buffer(2),
+      wait_horizons(3),
+      select_nodes(20000),
+      select_ms(50),
+      select_horizon(60),
+      predict_rate(0),
+      endgame_planets(6),
+      endgame_fleets(16),
+      endgame_ms(300),
+      endgame_depth(40),
+      endgame_branching(6),
+      endgame_growth_turns(10),
+      eval_growth(100),
+      eval_ships(100),
+      eval_fleets(100),
+      eval_pressure(0),
+      eval_projected(0),
+      max_turns(200),
+      speculate(1),
+      warmup(1),
+      threads(1) {
+}
+
+bool Params::Set(const std::string& assignment) {
+  std::string::size_type eq = assignment.find('=');
+  if (eq == std::string::npos)
+    return false;
+  const std::string name = assignment.substr(0, eq);
+  const std::string value = assignment.substr(eq + 1);
+  char *end = 0;
+  long v = strtol(value.c_str(), &end, 10);
+  if (value.empty() || *end != '\0')
+    return false;
+  for (int i = 0; i < kNumParams; ++i) {
+    const ParamInfo& info = kParamTable[i];
+    if (name != info.name)
+      continue;
+    if (v < info.min || v > info.max)
+      return false;
+    this->*info.field = (int)v;
+    return true;
+  }
+  return false;
+}
+
+std::string Params::ToString() const {
+  std::stringstream s;
+  for (int i = 0; i < kNumParams; ++i) {
+    if (i > 0)
+      s << " ";
+    s << kParamTable[i].name << "=" << this->*kParamTable[i].field;
+  }
+  return s.str();
+}
@@ -0,0 +1,116 @@
+// The planner in MyBot.cc is driven by a handful of constants. They live in
+// this struct so they can be overridden on the command line (as name=value
+// arguments) and searched by tools/Tuner.cc without rebuilding the bot.
+#ifndef PARAMS_H_
+#define PARAMS_H_
+
+#include <string>
+
+class Params {
+ public:
+  // Initializes every parameter to the values the bot was hand tuned with.
+  Params();
+
+  // Ships an attacking planet always keeps back for itself.
+  int buffer;
+
+  // Extra ships sent on top of what a target is expected to have.
+  int attack_margin;
+
+  // Smallest move worth sending, as in min(required, min_move).
+  int min_move;
+
+  // An attack that is not certain to win is dropped when its longest move
+  // takes more than turn + distance_slack turns.
+  int distance_slack;
+
+  // A planet needs at least this many ships before it helps a neighbor.
+  int defend_min_ships;
+
+  // A defensive move must send more than this many ships.
+  int defend_min_move;
+
+  // Ships a defending planet keeps back for itself.
+  int defend_buffer;
+
+  // Number of wait horizons (turns of growth) the planner considers.
+  int wait_horizons;
+
+  // Actions are chosen by a branch and bound search of at most
+  // select_nodes nodes and select_ms milliseconds; 0 nodes picks them
+  // greedily. An action is worth its growth times the turns it has left to
+  // pay off within select_horizon turns.
+  int select_nodes;
+  int select_ms;
+  int select_horizon;
+
+  // Enemy planets that launched on at least predict_rate percent of recent
+  // turns are expected to launch again, and the planner defends against
+  // those fleets as if they were in flight (see FleetTracker.h). 0 turns
+  // the prediction off.
+  int predict_rate;
+
+  // The endgame solver takes over once at most endgame_planets planets
+  // matter (owned, or neutral and growing) and at most endgame_fleets
+  // fleets are in flight.
+  int endgame_planets;
+  int endgame_fleets;
+
+  // Time the endgame solver may use per turn, in milliseconds.
+  int endgame_ms;
+
+  // Deepest endgame search, in turns.
+  int endgame_depth;
+
+  // Candidate moves per player per turn in the endgame search, not counting
+  // doing nothing.
+  int endgame_branching;
+
+  // Turns of growth a planet is worth when the endgame search has to guess.
+  int endgame_growth_turns;
+
+  // Weights, in percent, of the features that score a search leaf (see
+  // Evaluator.h).
+  int eval_growth;
+  int eval_ships;
+  int eval_fleets;
+  int eval_pressure;
+  int eval_projected;
+
+  // Length of the game in turns.
+  int max_turns;
+
+  // Plan the next turn in the background while the enemy is thinking.
+  int speculate;
+
+  // Plan a made-up turn before the first "go" so the first real turn starts
+  // with the threads running and the buffers grown (see Warmup()).
+  int warmup;
+
+  // Threads, including the main one, that generate candidate actions.
+  int threads;
+
+  // Sets one parameter from a "name=value" string. Returns false if the name
+  // is unknown or the value is not an integer inside the parameter's range.
+  bool Set(const std::string& assignment);
+
+  // Returns all parameters as space separated name=value pairs, the same
+  // format Set() accepts.
+  std::string ToString() const;
+};
+
+// Describes one field of Params and the range it may take. Fields that are
+// not tunable (time budgets, game rules) are left alone by the tuner.
+struct ParamInfo {
+  const char *name;
+  int Params::*field;
+  int min;
+  int max;
+  bool tunable;
+};
+
+// All parameters, in declaration order.
+extern const ParamInfo kParamTable[];
+extern const int kNumParams;
+
+#endif
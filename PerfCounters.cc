@@ -0,0 +1,179 @@
+#include "PerfCounters.h"
+
+#include <cstring>
+#include <unistd.h>
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#endif
+
+namespace {
+
+#ifdef __linux__
+// Starts counting one event for the calling thread, in user space only.
+int OpenEvent(uint32_t type, uint64_t config) {
+  struct perf_event_attr attr;
+  memset(&attr, 0, sizeof(attr));
+  attr.size = sizeof(attr);
+  attr.type = type;
+  attr.config = config;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  attr.read_format =
+      PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+  return syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+}
+#endif
+
+}  // namespace
+
+PerfCounters::PerfCounters() {
+  for (int c = 0; c < kNumCounters; ++c)
+    fds_[c] = -1;
+}
+
+PerfCounters::~PerfCounters() {
+  Close();
+}
+
+bool PerfCounters::Open() {
+  Close();
+#ifdef __linux__
+  fds_[kCycles] = OpenEvent(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+  fds_[kInstructions] =
+      OpenEvent(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+  fds_[kL1dMisses] = OpenEvent(PERF_TYPE_HW_CACHE,
+                               PERF_COUNT_HW_CACHE_L1D |
+                               (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                               (PERF_COUNT_HW_CACHE_RESULT_MISS << 16));
+  fds_[kLlcMisses] = OpenEvent(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+  fds_[kBranchMisses] =
+      OpenEvent(PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES);
+#endif
+  for (int c = 0; c < kNumCounters; ++c) {
+    if (fds_[c] >= 0)
+      return true;
+  }
+  return false;
+}
+
+void PerfCounters::Close() {
+  for (int c = 0; c < kNumCounters; ++c) {
+    if (fds_[c] >= 0)
+      close(fds_[c]);
+    fds_[c] = -1;
+  }
+}
+
+const char *PerfCounters::Name(Counter counter) {
+  static const char *const kNames[kNumCounters] = {
+    "cycles", "instructions", "l1d_misses", "llc_misses", "branch_misses"
+  };
+  return kNames[counter];
+}
+
+void PerfCounters::Read(Values *values) const {
+  for (int c = 0; c < kNumCounters; ++c) {
+    values->counts[c] = 0;
+    uint64_t data[3];  // value, time enabled, time running
+    if (fds_[c] < 0 || read(fds_[c], data, sizeof(data)) != sizeof(data) ||
+        data[2] == 0)
+      continue;
+    values->counts[c] = data[1] == data[2]
+        ? data[0]
+        : (uint64_t)((long double)data[0] * data[1] / data[2]);
+  }
+}
+
+void PerfCounters::Write(FILE *out, const Values& values) const {
+  for (int c = 0; c < kNumCounters; ++c) {
+    if (Available((Counter)c))
+      fprintf(out, " %s=%llu", Name((Counter)c),
+              (unsigned long long)values.counts[c]);
+  }
+  if (Available(kCycles) && Available(kInstructions) &&
+      values.counts[kCycles] > 0)
+    fprintf(out, " ipc=%.3f",
+            (double)values.counts[kInstructions] / values.counts[kCycles]);
+}
+
+PerfProfile::PerfProfile() : out_(0), turn_ms_(0), last_ms_(0) {
+  memset(&turn_values_, 0, sizeof(turn_values_));
+  memset(&last_values_, 0, sizeof(last_values_));
+}
+
+bool PerfProfile::Open(const std::string& path) {
+  out_ = fopen(path.c_str(), "w");
+  if (!out_)
+    return false;
+  counters_.Open();
+  fprintf(out_, "perf counters=");
+  bool any = false;
+  for (int c = 0; c < PerfCounters::kNumCounters; ++c) {
+    const PerfCounters::Counter counter = (PerfCounters::Counter)c;
+    if (counters_.Available(counter)) {
+      fprintf(out_, "%s%s", any ? "," : "", PerfCounters::Name(counter));
+      any = true;
+    }
+  }
+  fprintf(out_, "%s\n", any ? "" : "none");
+  fflush(out_);
+  return true;
+}
+
+void PerfProfile::Sample(double *ms, PerfCounters::Values *values) const {
+  *ms = timer_.ElapsedMs();
+  counters_.Read(values);
+}
+
+void PerfProfile::BeginTurn() {
+  if (!out_)
+    return;
+  phases_.clear();
+  Sample(&turn_ms_, &turn_values_);
+  last_ms_ = turn_ms_;
+  last_values_ = turn_values_;
+}
+
+void PerfProfile::Mark(const char *phase) {
+  if (!out_)
+    return;
+  double ms;
+  PerfCounters::Values values;
+  Sample(&ms, &values);
+  size_t i = 0;
+  while (i < phases_.size() && strcmp(phases_[i].name, phase) != 0)
+    ++i;
+  if (i == phases_.size()) {
+    Phase empty;
+    memset(&empty, 0, sizeof(empty));
+    empty.name = phase;
+    phases_.push_back(empty);
+  }
+  Phase& p = phases_[i];
+  p.ms += ms - last_ms_;
+  for (int c = 0; c < PerfCounters::kNumCounters; ++c)
+    p.values.counts[c] += values.counts[c] - last_values_.counts[c];
+  last_ms_ = ms;
+  last_values_ = values;
+}
+
+void PerfProfile::EndTurn(int turn) {
+  if (!out_)
+    return;
+  double ms;
+  PerfCounters::Values values;
+  Sample(&ms, &values);
+  for (size_t i = 0; i < phases_.size(); ++i) {
+    fprintf(out_, "perf turn=%d phase=%s ms=%.3f", turn, phases_[i].name,
+            phases_[i].ms);
+    counters_.Write(out_, phases_[i].values);
+    fprintf(out_, "\n");
+  }
+  for (int c = 0; c < PerfCounters::kNumCounters; ++c)
+    values.counts[c] -= turn_values_.counts[c];
+  fprintf(out_, "perf turn=%d phase=turn ms=%.3f", turn, ms - turn_ms_);
+  counters_.Write(out_, values);
+  fprintf(out_, "\n");
+  fflush(out_);
+}
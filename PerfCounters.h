@@ -0,0 +1,109 @@
+// Hardware performance counters for the calling thread, through Linux
+// perf_event_open(2).
+//
+// Wall-clock time says how long a phase took; the counters say why: few
+// instructions per cycle with many cache misses points at memory, many
+// branch misses at unpredictable comparisons. Only user-space events are
+// counted, which perf_event_paranoid up to 2 allows.
+//
+// Every counter is opened on its own, so a machine or VM without, say, an
+// LLC miss event still gets the others. Without perf_event_open at all
+// (another OS, a seccomp sandbox, perf_event_paranoid 3) Open() returns
+// false, every counter reads 0 and PerfProfile still records time.
+//
+// Counters follow one thread. Work handed to the ThreadPool is not seen
+// unless the pool has a single thread.
+#ifndef PERF_COUNTERS_H_
+#define PERF_COUNTERS_H_
+
+#include "Timer.h"
+
+#include <cstdio>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+class PerfCounters {
+ public:
+  enum Counter {
+    kCycles,
+    kInstructions,
+    kL1dMisses,
+    kLlcMisses,
+    kBranchMisses,
+    kNumCounters
+  };
+
+  // Counter values, 0 for the ones that are not available.
+  struct Values {
+    uint64_t counts[kNumCounters];
+  };
+
+  PerfCounters();
+  ~PerfCounters();
+
+  // Opens and starts every counter the machine has. Returns false if none
+  // could be opened.
+  bool Open();
+  void Close();
+
+  bool Available(Counter counter) const { return fds_[counter] >= 0; }
+
+  // Name of a counter as it is written out, e.g. "l1d_misses".
+  static const char *Name(Counter counter);
+
+  // Reads every counter's total since Open(), scaled up for the time it
+  // was not scheduled when the PMU had more events than registers.
+  void Read(Values *values) const;
+
+  // Writes " name=value" for every available counter of values, and
+  // " ipc=..." if cycles and instructions are both there.
+  void Write(FILE *out, const Values& values) const;
+
+ private:
+  int fds_[kNumCounters];
+
+  PerfCounters(const PerfCounters&);
+  void operator=(const PerfCounters&);
+};
+
+// Splits each turn into named phases and writes a line per phase and one
+// for the whole turn:
+//   perf turn=12 phase=generate ms=0.041 cycles=101234 instructions=...
+// Mark(phase) charges everything since the previous mark (or BeginTurn())
+// to phase; a phase marked twice in a turn adds up.
+class PerfProfile {
+ public:
+  PerfProfile();
+
+  // Starts writing to path, which is truncated. Returns false if it cannot
+  // be written. The first line says which counters there are, e.g.
+  // "perf counters=cycles,instructions" or "perf counters=none".
+  bool Open(const std::string& path);
+
+  bool Enabled() const { return out_ != 0; }
+
+  void BeginTurn();
+  void Mark(const char *phase);
+  void EndTurn(int turn);
+
+ private:
+  struct Phase {
+    const char *name;
+    double ms;
+    PerfCounters::Values values;
+  };
+
+  void Sample(double *ms, PerfCounters::Values *values) const;
+
+  PerfCounters counters_;
+  FILE *out_;
+  Timer timer_;
+  double turn_ms_;
+  PerfCounters::Values turn_values_;
+  double last_ms_;
+  PerfCounters::Values last_values_;
+  std::vector<Phase> phases_;
+};
+
+#endif
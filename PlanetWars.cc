@@ -1,6 +1,7 @@
 #include "PlanetWars.h"
 #include <cmath>
 #include <cstdlib>
+#include <cstring>
 #include <iostream>
 #include <sstream>
 #include <string>
@@ -37,8 +38,8 @@ Fleet::Fleet(int owner,
              int destination_planet,
              int total_trip_length,
              int turns_remaining) {
-  owner_ = owner;
   num_ships_ = num_ships;
+  owner_ = owner;
   source_planet_ = source_planet;
   destination_planet_ = destination_planet;
   total_trip_length_ = total_trip_length;
@@ -127,6 +128,9 @@ PlanetWars::PlanetWars(const std::string& gameState) {
   ParseGameState(gameState);
 }
 
+PlanetWars::PlanetWars() {
+}
+
 int PlanetWars::NumPlanets() const {
   return planets_.size();
 }
@@ -251,7 +255,13 @@ int PlanetWars::Distance(int source_planet, int destination_planet) const {
 void PlanetWars::IssueOrder(int source_planet,
                             int destination_planet,
                             int num_ships) const {
-  planets_[source_planet].RemoveShips(num_ships);
+  ChangeShips(source_planet, -num_ships);
+  int distance = Distance(source_planet, destination_planet);
+  influence_.AddFleet(planets_[source_planet].Owner(), num_ships,
+                      destination_planet, distance);
+  orders_.push_back(Fleet(planets_[source_planet].Owner(), num_ships,
+                          source_planet, destination_planet,
+                          distance, distance));
 
   std::cout << source_planet << " "
             << destination_planet << " "
@@ -274,51 +284,247 @@ bool PlanetWars::IsAlive(int player_id) const {
 }
 
 int PlanetWars::ParseGameState(const std::string& s) {
+  BeginState();
+  std::string::size_type begin = 0;
+  while (begin < s.size()) {
+    std::string::size_type end = s.find('\n', begin);
+    if (end == std::string::npos)
+      end = s.size();
+    if (!ParseLine(s.data() + begin, end - begin)) {
+      // Keep what was read so the per-planet tables match the planets.
+      EndState();
+      return 0;
+    }
+    begin = end + 1;
+  }
+  EndState();
+  return 1;
+}
+
+void PlanetWars::BeginState() {
   planets_.clear();
   fleets_.clear();
-  std::vector<std::string> lines = StringUtil::Tokenize(s, "\n");
-  int planet_id = 0;
-  for (unsigned int i = 0; i < lines.size(); ++i) {
-    std::string& line = lines[i];
-    size_t comment_begin = line.find_first_of('#');
-    if (comment_begin != std::string::npos) {
-      line = line.substr(0, comment_begin);
+  my_fleets.clear();
+  enemy_fleets.clear();
+  orders_.clear();
+  predicted_fleets_.clear();
+}
+
+static bool IsSpace(char c) {
+  return c == ' ' || c == '\t' || c == '\r';
+}
+
+// Reads the number that token starts with into *value. Returns false if it
+// is outside [min, max], so it would not fit the field it is stored in.
+static bool ParseNumber(const char *token, long min, long max, int *value) {
+  const long v = strtol(token, 0, 10);
+  if (v < min || v > max)
+    return false;
+  *value = (int)v;
+  return true;
+}
+
+bool PlanetWars::ParseLine(const char *line, size_t length) {
+  const char *end = line + length;
+  const char *comment = (const char *)memchr(line, '#', length);
+  if (comment)
+    end = comment;
+
+  // Split into at most 8 tokens; a valid line has 6 or 7.
+  const int kMaxTokens = 8;
+  const char *tokens[kMaxTokens];
+  int num_tokens = 0;
+  const char *p = line;
+  while (num_tokens < kMaxTokens) {
+    while (p < end && IsSpace(*p))
+      ++p;
+    if (p == end)
+      break;
+    tokens[num_tokens++] = p;
+    while (p < end && !IsSpace(*p))
+      ++p;
+  }
+  if (num_tokens == 0)
+    return true;
+  if (tokens[0] + 1 != end && !IsSpace(tokens[0][1]))
+    return false;
+
+  // Numbers stop at the first space or newline, so strtol/strtod never read
+  // past the line even though it is not NUL terminated. Owners, planet ids,
+  // growth rates and trip lengths are kept in 16 bits and ship counts in 32,
+  // so a line with a number that does not fit is rejected rather than
+  // wrapped.
+  const long kMax16 = 32767, kMax32 = 2147483647;
+  if (tokens[0][0] == 'P') {
+    int owner, num_ships, growth_rate;
+    if (num_tokens != 6 || (long)planets_.size() > kMax16 ||
+        !ParseNumber(tokens[3], 0, kMax16, &owner) ||
+        !ParseNumber(tokens[4], 0, kMax32, &num_ships) ||
+        !ParseNumber(tokens[5], 0, kMax16, &growth_rate)) {
+      return false;
     }
-    std::vector<std::string> tokens = StringUtil::Tokenize(line);
-    if (tokens.size() == 0) {
-      continue;
+    Planet p(planets_.size(),                     // The ID of this planet
+             owner,
+             num_ships,
+             growth_rate,
+             strtod(tokens[1], 0),                // X
+             strtod(tokens[2], 0));               // Y
+    planets_.push_back(p);
+  } else if (tokens[0][0] == 'F') {
+    int owner, num_ships, source, destination, trip_length, turns_remaining;
+    if (num_tokens != 7 ||
+        !ParseNumber(tokens[1], 0, kMax16, &owner) ||
+        !ParseNumber(tokens[2], 0, kMax32, &num_ships) ||
+        !ParseNumber(tokens[3], 0, kMax16, &source) ||
+        !ParseNumber(tokens[4], 0, kMax16, &destination) ||
+        !ParseNumber(tokens[5], 0, kMax16, &trip_length) ||
+        !ParseNumber(tokens[6], 0, kMax16, &turns_remaining)) {
+      return false;
     }
-    if (tokens[0] == "P") {
-      if (tokens.size() != 6) {
-        return 0;
-      }
-      Planet p(planet_id++,              // The ID of this planet
-	       atoi(tokens[3].c_str()),  // Owner
-               atoi(tokens[4].c_str()),  // Num ships
-               atoi(tokens[5].c_str()),  // Growth rate
-               atof(tokens[1].c_str()),  // X
-               atof(tokens[2].c_str())); // Y
-        p.pw = this;
-      planets_.push_back(p);
-    } else if (tokens[0] == "F") {
-      if (tokens.size() != 7) {
-        return 0;
-      }
-      Fleet f(atoi(tokens[1].c_str()),  // Owner
-              atoi(tokens[2].c_str()),  // Num ships
-              atoi(tokens[3].c_str()),  // Source
-              atoi(tokens[4].c_str()),  // Destination
-              atoi(tokens[5].c_str()),  // Total trip length
-              atoi(tokens[6].c_str())); // Turns remaining
-      fleets_.push_back(f);
+    Fleet f(owner, num_ships, source, destination, trip_length,
+            turns_remaining);
+    fleets_.push_back(f);
+    if (f.Owner() == 1)
+      my_fleets.push_back(f);
+    else if (f.Owner() > 1)
+      enemy_fleets.push_back(f);
+  } else {
+    return false;
+  }
+  return true;
+}
+
+// Adds f to the groups headed for its destination, if that is one of the
+// first num_planets planets.
+static void AddArrival(const Fleet& f, size_t num_planets,
+                       std::vector<std::vector<FleetGroup> >& arrivals) {
+  const int destination = f.DestinationPlanet();
+  if (destination < 0 || destination >= (int)num_planets)
+    return;
+  FleetGroup group = { f.Owner(), f.NumShips(), 1, f.TurnsRemaining() };
+  arrivals[destination].push_back(group);
+}
+
+// The last to arrive first, then by owner.
+static bool LaterArrival(const FleetGroup& a, const FleetGroup& b) {
+  if (a.turns_remaining != b.turns_remaining)
+    return a.turns_remaining > b.turns_remaining;
+  return a.owner < b.owner;
+}
+
+// Sorts one planet's groups and merges the ones of an owner that arrive on
+// the same turn.
+static void MergeArrivals(std::vector<FleetGroup>& groups) {
+  std::sort(groups.begin(), groups.end(), LaterArrival);
+  size_t write = 0;
+  for (size_t i = 0; i < groups.size(); ++i) {
+    if (write > 0 && groups[write - 1].owner == groups[i].owner &&
+        groups[write - 1].turns_remaining == groups[i].turns_remaining) {
+      groups[write - 1].num_ships += groups[i].num_ships;
+      groups[write - 1].num_fleets += groups[i].num_fleets;
     } else {
-      return 0;
+      groups[write++] = groups[i];
     }
   }
-  my_fleets = get_MyFleets();
-  enemy_fleets = get_EnemyFleets();
+  groups.resize(write);
+}
 
-  return 1;
+void PlanetWars::EndState() {
+  // The inner vectors are cleared rather than dropped to keep their storage
+  // from one turn to the next.
+  const size_t num_planets = planets_.size();
+  if (my_arrivals_.size() < num_planets) {
+    my_arrivals_.resize(num_planets);
+    enemy_arrivals_.resize(num_planets);
+  }
+  for (size_t i = 0; i < num_planets; ++i) {
+    my_arrivals_[i].clear();
+    enemy_arrivals_[i].clear();
+  }
+  for (size_t i = 0; i < my_fleets.size(); ++i)
+    AddArrival(my_fleets[i], num_planets, my_arrivals_);
+  for (size_t i = 0; i < enemy_fleets.size(); ++i)
+    AddArrival(enemy_fleets[i], num_planets, enemy_arrivals_);
+  for (size_t i = 0; i < predicted_fleets_.size(); ++i)
+    AddArrival(predicted_fleets_[i], num_planets, enemy_arrivals_);
+  stats_.resize(num_planets);
+  for (size_t i = 0; i < num_planets; ++i) {
+    MergeArrivals(my_arrivals_[i]);
+    MergeArrivals(enemy_arrivals_[i]);
+    ComputeStats(i);
+  }
+
+  // The spatial index and the influence map's positions only change with
+  // the map; the planets and fleets are brought up to date on top of them.
+  std::vector<double> layout;
+  layout.reserve(2 * num_planets);
+  for (size_t i = 0; i < num_planets; ++i) {
+    layout.push_back(planets_[i].X());
+    layout.push_back(planets_[i].Y());
+  }
+  if (layout != layout_) {
+    layout_.swap(layout);
+    influence_.SetMap(layout_);
+    spatial_.Build(layout_);
+  }
+  for (size_t i = 0; i < num_planets; ++i) {
+    const Planet& p = planets_[i];
+    influence_.SetPlanet(i, p.Owner(), p.NumShips(), p.GrowthRate());
+    spatial_.SetOwner(i, p.Owner());
+  }
+  influence_.ClearFleets();
+  for (size_t i = 0; i < fleets_.size(); ++i) {
+    const Fleet& f = fleets_[i];
+    if (f.DestinationPlanet() >= 0 && f.DestinationPlanet() < (int)num_planets)
+      influence_.AddFleet(f.Owner(), f.NumShips(), f.DestinationPlanet(),
+                          f.TurnsRemaining());
+  }
+}
+
+void PlanetWars::ChangeShips(int planet_id, int amount) const {
+  Planet& p = planets_[planet_id];
+  p.AddShips(amount);
+  influence_.SetPlanet(planet_id, p.Owner(), p.NumShips(), p.GrowthRate());
+  ComputeStats(planet_id);
+}
+
+void PlanetWars::ComputeStats(int planet_id) const {
+  const Planet& p = planets_[planet_id];
+  const std::vector<FleetGroup>& mine = my_arrivals_[planet_id];
+  const std::vector<FleetGroup>& enemy = enemy_arrivals_[planet_id];
+  PlanetStats& stats = stats_[planet_id];
+
+  stats.under_attack = 0;
+  stats.under_attack_distance = 0;
+  for (size_t i = 0; i < enemy.size(); ++i) {
+    stats.under_attack += enemy[i].num_ships;
+    stats.under_attack_distance = std::min(stats.under_attack_distance,
+                                           enemy[i].turns_remaining);
+  }
+
+  stats.real_attack_count = p.NumShips();
+  for (size_t i = 0; i < mine.size(); ++i)
+    stats.real_attack_count -= mine[i].num_ships;
+
+  // The last enemy group is the first to arrive.
+  if (enemy.empty()) {
+    stats.real_ship_count = p.NumShips();
+    stats.time_left = p.NumShips();
+    return;
+  }
+  const int time_left = enemy.back().turns_remaining;
+  const int will_have = p.NumShips() + time_left * p.GrowthRate();
+  // Every enemy fleet, not group, is worth a ship more than it carries.
+  int fighters = 0;
+  for (size_t i = 0; i < enemy.size(); ++i)
+    fighters += enemy[i].num_ships + enemy[i].num_fleets;
+  int real_count = will_have - fighters;
+  for (size_t i = 0; i < mine.size(); ++i) {
+    if (mine[i].turns_remaining < time_left)
+      real_count += mine[i].num_ships;
+  }
+  stats.real_ship_count = std::min(real_count, p.NumShips());
+  stats.time_left = time_left;
 }
 
 void PlanetWars::FinishTurn() const {
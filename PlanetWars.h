@@ -6,11 +6,15 @@
 #ifndef PLANET_WARS_H_
 #define PLANET_WARS_H_
 
-#define uint unsigned int
+#include "Influence.h"
+#include "SpatialIndex.h"
+#include <stdint.h>
 #include <string>
 #include <vector>
 #include <algorithm>
 
+typedef unsigned int uint;
+
 // This is a utility class that parses strings.
 class StringUtil {
  public:
@@ -62,22 +66,32 @@ class Fleet {
   int TurnsRemaining() const;
 
  private:
-  int owner_;
-  int num_ships_;
-  int source_planet_;
-  int destination_planet_;
-  int total_trip_length_;
-  int turns_remaining_;
+  // Ships are counted in 32 bits like on planets. Planet ids and trip
+  // lengths fit in 16 bits (ParseLine() rejects anything larger), which
+  // keeps a fleet at 16 bytes instead of 24.
+  int32_t num_ships_;
+  int16_t owner_;
+  int16_t source_planet_;
+  int16_t destination_planet_;
+  int16_t total_trip_length_;
+  int16_t turns_remaining_;
+};
+
+// The fleets of one owner that land on the same planet on the same turn.
+// They fight as one force, so the per-planet queries and the simulations
+// look at the groups instead of every fleet; num_fleets keeps what still
+// counts each fleet.
+struct FleetGroup {
+  int owner;
+  int num_ships;
+  int num_fleets;
+  int turns_remaining;
 };
-class PlanetWars;
 
 // Stores information about one planet. There is one instance of this class
 // for each planet on the map.
 class Planet {
  public:
-    PlanetWars *pw;
-    bool party;
-
   // Initializes a planet.
   Planet(int planet_id,
          int owner,
@@ -117,10 +131,10 @@ class Planet {
   void RemoveShips(int amount);
 
  private:
-  int planet_id_;
-  int owner_;
-  int num_ships_;
-  int growth_rate_;
+  int16_t planet_id_;
+  int16_t owner_;
+  int32_t num_ships_;
+  int16_t growth_rate_;
   double x_, y_;
 };
 
@@ -131,6 +145,18 @@ class PlanetWars {
   // Initializes the game state given a string containing game state data.
   PlanetWars(const std::string& game_state);
 
+  // Initializes an empty game state, to be filled in a line at a time.
+  PlanetWars();
+
+  // Builds the state as the engine sends it, without buffering the turn:
+  // BeginState() forgets the previous turn (keeping its storage),
+  // ParseLine() adds one "P" or "F" line to the planets, fleets and the
+  // per-owner fleet lists, and EndState() finishes the turn once "go"
+  // arrives. ParseLine() returns false if the line is malformed.
+  void BeginState();
+  bool ParseLine(const char *line, size_t length);
+  void EndState();
+
   // Returns the number of planets on the map. Planets are numbered starting
   // with 0.
   int NumPlanets() const;
@@ -139,43 +165,33 @@ class PlanetWars {
   // planets. They are numbered starting at 0.
   const Planet& GetPlanet(int planet_id) const;
 
+    // The per-planet queries below are answered from a table worked out in
+    // EndState(). IssueOrder() and removeShips() recompute the entry of the
+    // planet they change, so the answers stay exact through the turn.
     int UnderAttack(int planet_id) const
     {
-        int total = 0;
-        const std::vector<Fleet> enemy_fleets = EnemyFleets();
-        for (uint i = 0; i < enemy_fleets.size(); ++i) {
-            if (enemy_fleets[i].DestinationPlanet() == planet_id) {
-                total += enemy_fleets[i].NumShips();
-            }
-        }
-        return total;
+        return stats_[planet_id].under_attack;
     }
 
     int UnderAttackDistance(int planet_id) const
     {
-        int distance = 0;
-        const std::vector<Fleet> enemy_fleets = EnemyFleets();
-        for (uint i = 0; i < enemy_fleets.size(); ++i) {
-            if (enemy_fleets[i].DestinationPlanet() == planet_id) {
-                distance = std::min(distance, enemy_fleets[i].TurnsRemaining());
-            }
-        }
-        return distance;
+        return stats_[planet_id].under_attack_distance;
     }
 
-    int NearestEmpty(int planet_id) const
-    {
-        int nearest = -1;
-        int nearestID = -1;
-        const std::vector<Planet> planets = NeutralPlanets();
-        for (uint i = 0; i < planets.size(); ++i) {
-            int d = Distance(planet_id, planets[i].PlanetID());
-            if (nearest == -1 || nearest > d) {
-                nearestID = planets[i].PlanetID();
-                nearest = d;
-            }
-        }
-        return nearestID;
+    // The k planets nearest to planet_id among the owner classes in owners
+    // (see SpatialIndex), nearest and then lowest id first.
+    void NearestPlanets(int planet_id, int k, int owners,
+                        std::vector<int> *nearest) const {
+        const Planet& p = planets_[planet_id];
+        spatial_.Nearest(p.X(), p.Y(), k, owners, nearest);
+    }
+
+    // The planets of the owner classes in owners at most turns turns from
+    // planet_id, in the same order.
+    void PlanetsWithin(int planet_id, int turns, int owners,
+                       std::vector<int> *within) const {
+        const Planet& p = planets_[planet_id];
+        spatial_.Within(p.X(), p.Y(), turns, owners, within);
     }
 
     bool party(int planet_id) const
@@ -189,53 +205,35 @@ class PlanetWars {
 
     int real_attack_count(int planet_id) const
     {
-        const Planet p = GetPlanet(planet_id);
-        int c = p.NumShips();
-
-        const std::vector<Fleet> fleets = MyFleets();
-        for (uint i = 0; i < fleets.size(); ++i) {
-            if (fleets[i].DestinationPlanet() == planet_id)
-                c -= my_fleets[i].NumShips();
-        }
-        return c;
+        return stats_[planet_id].real_attack_count;
     }
 
     int real_ship_count(int planet_id) const
     {
-        const Planet p = GetPlanet(planet_id);
-        const std::vector<Fleet> enemy_fleets = EnemyFleets(planet_id);
-        if (enemy_fleets.size() == 0)
-            return p.NumShips();
-        int i = enemy_fleets.size() - 1;
-        int time_left = enemy_fleets[i].TurnsRemaining();
-        int willHave = p.NumShips() + time_left * p.GrowthRate();
-        int fighters = 0;
-        for (uint i = 0; i < enemy_fleets.size(); ++i) {
-            fighters += enemy_fleets[i].NumShips() + 1;
-        }
-        int real_count = willHave - fighters;
-        int my_real_count = p.NumShips();
-
-        const std::vector<Fleet> my_fleets = MyFleets();
-        for (uint i = 0; i < my_fleets.size(); ++i) {
-            if (my_fleets[i].DestinationPlanet() != planet_id)
-                continue;
-            if (my_fleets[i].TurnsRemaining() < time_left)
-                real_count += my_fleets[i].NumShips();
-        }
-        if (real_count > p.NumShips())
-            return my_real_count;
-        return real_count;
+        return stats_[planet_id].real_ship_count;
     }
 
     int time_left(int planet_id) const
     {
-        const Planet p = GetPlanet(planet_id);
-        const std::vector<Fleet> enemy_fleets = EnemyFleets(planet_id);
-        if (enemy_fleets.size() == 0)
-            return  p.NumShips();
-        int i = enemy_fleets.size() - 1;
-        return enemy_fleets[i].TurnsRemaining();
+        return stats_[planet_id].time_left;
+    }
+
+    // Influence queries, see Influence.h. They follow the orders issued
+    // this turn.
+    int Reach(int player_id, int planet_id) const {
+        return influence_.Reach(player_id, planet_id);
+    }
+
+    int Strength(int player_id, int planet_id, int turns) const {
+        return influence_.Strength(player_id, planet_id, turns);
+    }
+
+    int MaxDistance() const { return influence_.MaxDistance(); }
+
+    // Fills frontier with the planets where player_id and the nearest other
+    // player could land ships within margin turns of each other.
+    void Frontier(int player_id, int margin, std::vector<int> *frontier) const {
+        influence_.Frontier(player_id, margin, frontier);
     }
 
     int GrowthRate(int player_id) const {
@@ -287,19 +285,14 @@ class PlanetWars {
   std::vector<Fleet> EnemyFleets() const { return enemy_fleets; };
   std::vector<Fleet> get_EnemyFleets() const;
 
-    // Return a list of all the fleets owned by enemy players.
-    std::vector<Fleet> EnemyFleets(int planet_id) const {
-        std::vector<Fleet> my;
-        std::vector<Fleet> all = EnemyFleets();
-        for (uint i = 0; i < all.size(); ++i)
-            if (all[i].DestinationPlanet() == planet_id)
-                my.push_back(all[i]);
-        sort(my.begin(), my.end(), attacking_fleet_sort);
-        return my;
+    // Return the enemy fleets headed for planet_id as groups, the last to
+    // arrive first. The fleets themselves are still in EnemyFleets().
+    const std::vector<FleetGroup>& EnemyArrivals(int planet_id) const {
+        return enemy_arrivals_[planet_id];
     }
 
   void removeShips(int planet_id, int count) const {
-    planets_[planet_id].RemoveShips(count);
+    ChangeShips(planet_id, -count);
   }
 
 
@@ -321,6 +314,17 @@ class PlanetWars {
 		  int destination_planet,
 		  int num_ships) const;
 
+  // Returns the orders issued so far this turn, as the fleets they launch.
+  const std::vector<Fleet>& Orders() const { return orders_; }
+
+  // Enemy fleets expected to leave this turn (see FleetTracker.h), set
+  // between parsing and EndState(). They count towards EnemyArrivals()
+  // and the per-planet queries, but not towards Fleets() or the influence
+  // map.
+  void SetPredictedFleets(const std::vector<Fleet>& fleets) {
+    predicted_fleets_ = fleets;
+  }
+
   // Returns true if the named player owns at least one planet or fleet.
   // Otherwise, the player is deemed to be dead and false is returned.
   bool IsAlive(int player_id) const;
@@ -338,12 +342,40 @@ class PlanetWars {
   // returns 0.
   int ParseGameState(const std::string& s);
 
+  // What the per-planet queries return for one planet.
+  struct PlanetStats {
+    int under_attack;
+    int under_attack_distance;
+    int real_attack_count;
+    int real_ship_count;
+    int time_left;
+  };
+
+  // Fills in stats_[planet_id] from the planet and the fleets headed for it.
+  void ComputeStats(int planet_id) const;
+
+  // Adds amount ships to a planet and updates everything derived from it.
+  void ChangeShips(int planet_id, int amount) const;
+
   // Store all the planets and fleets. OMG we wouldn't wanna lose all the
   // planets and fleets, would we!?
   mutable std::vector<Planet> planets_;
   std::vector<Fleet> fleets_;
   std::vector<Fleet> my_fleets;
   std::vector<Fleet> enemy_fleets;
+  mutable std::vector<Fleet> orders_;
+  std::vector<Fleet> predicted_fleets_;
+
+  // Fleet groups by destination planet, and the query table built from
+  // them.
+  std::vector<std::vector<FleetGroup> > my_arrivals_;
+  std::vector<std::vector<FleetGroup> > enemy_arrivals_;
+  mutable std::vector<PlanetStats> stats_;
+
+  // Planet positions the influence map and spatial index were set up for.
+  std::vector<double> layout_;
+  mutable InfluenceMap influence_;
+  SpatialIndex spatial_;
 };
 
 #endif
@@ -0,0 +1,134 @@
+#include "Selection.h"
+
+ActionSelector::ActionSelector()
+    : best_value_(0),
+      budget_ms_(0),
+      max_nodes_(0),
+      nodes_(0),
+      aborted_(false) {
+}
+
+void ActionSelector::Reset(int num_planets) {
+  candidates_.clear();
+  uses_.clear();
+  capacity_.assign(num_planets, 0);
+  taken_.assign((num_planets + 63) / 64, 0);
+  bound_value_.assign(num_planets, -1);
+}
+
+void ActionSelector::SetCapacity(int planet_id, int ships) {
+  capacity_[planet_id] = ships;
+}
+
+int ActionSelector::AddCandidate(int target, int value) {
+  Candidate c = { target, value, (int)uses_.size(), 0 };
+  candidates_.push_back(c);
+  return candidates_.size() - 1;
+}
+
+void ActionSelector::AddUse(int planet_id, int need, int take) {
+  Use use = { planet_id, need, take };
+  uses_.push_back(use);
+  candidates_.back().num_uses++;
+}
+
+bool ActionSelector::Fits(int c) const {
+  const Candidate& candidate = candidates_[c];
+  if (Taken(candidate.target))
+    return false;
+  for (int i = 0; i < candidate.num_uses; ++i) {
+    const Use& use = uses_[candidate.first_use + i];
+    if (capacity_[use.planet_id] < use.need)
+      return false;
+  }
+  return true;
+}
+
+// Takes candidate c with sign 1 and gives it back with sign -1.
+void ActionSelector::Apply(int c, int sign) {
+  const Candidate& candidate = candidates_[c];
+  Flip(candidate.target);
+  for (int i = 0; i < candidate.num_uses; ++i) {
+    const Use& use = uses_[candidate.first_use + i];
+    capacity_[use.planet_id] -= sign * use.take;
+  }
+}
+
+// An upper bound on the value the candidates from first on can still add:
+// the best candidate that fits on its own, for every target still free.
+int ActionSelector::Bound(int first) {
+  for (size_t c = first; c < candidates_.size(); ++c) {
+    const Candidate& candidate = candidates_[c];
+    if (candidate.value <= bound_value_[candidate.target] || !Fits(c))
+      continue;
+    if (bound_value_[candidate.target] < 0)
+      bound_targets_.push_back(candidate.target);
+    bound_value_[candidate.target] = candidate.value;
+  }
+  int bound = 0;
+  for (size_t i = 0; i < bound_targets_.size(); ++i) {
+    bound += bound_value_[bound_targets_[i]];
+    bound_value_[bound_targets_[i]] = -1;
+  }
+  bound_targets_.clear();
+  return bound;
+}
+
+bool ActionSelector::OutOfBudget() {
+  if (nodes_ >= max_nodes_ ||
+      ((nodes_ & 1023) == 0 && timer_.ElapsedMs() > budget_ms_))
+    aborted_ = true;
+  return aborted_;
+}
+
+void ActionSelector::Search(int c, int value) {
+  ++nodes_;
+  if (OutOfBudget())
+    return;
+  if (c == (int)candidates_.size()) {
+    if (value > best_value_) {
+      best_value_ = value;
+      best_ = stack_;
+    }
+    return;
+  }
+  if (value + Bound(c) <= best_value_)
+    return;
+
+  if (Fits(c)) {
+    Apply(c, 1);
+    stack_.push_back(c);
+    Search(c + 1, value + candidates_[c].value);
+    stack_.pop_back();
+    Apply(c, -1);
+  }
+  Search(c + 1, value);
+}
+
+void ActionSelector::Solve(long max_nodes, double budget_ms,
+                           std::vector<int> *chosen) {
+  timer_.Start();
+  budget_ms_ = budget_ms;
+  max_nodes_ = max_nodes;
+  nodes_ = 0;
+  aborted_ = false;
+
+  // The greedy answer is the first set to beat.
+  best_.clear();
+  best_value_ = 0;
+  for (size_t c = 0; c < candidates_.size(); ++c) {
+    if (!Fits(c))
+      continue;
+    Apply(c, 1);
+    best_.push_back(c);
+    best_value_ += candidates_[c].value;
+  }
+  for (size_t i = best_.size(); i-- > 0;)
+    Apply(best_[i], -1);
+
+  if (max_nodes > 0) {
+    stack_.clear();
+    Search(0, 0);
+  }
+  *chosen = best_;
+}
@@ -0,0 +1,90 @@
+// Picks the set of candidate actions to carry out this turn.
+//
+// Every candidate targets one planet and draws ships from a few source
+// planets. At most one candidate may be chosen per target, and together the
+// chosen candidates may not draw more ships from a source than it can spare.
+// Within those limits the selector looks for the set with the largest total
+// value by branch and bound over the candidates in the order they were
+// added, trying to take each one before trying to skip it. The first set it
+// reaches that way is the greedy answer, so when the node or time budget
+// runs out the result is never worse than greedy.
+#ifndef SELECTION_H_
+#define SELECTION_H_
+
+#include "Timer.h"
+#include <stdint.h>
+#include <vector>
+
+class ActionSelector {
+ public:
+  ActionSelector();
+
+  // Forgets all candidates and gives num_planets planets no ships to spare.
+  void Reset(int num_planets);
+
+  // Sets the ships planet_id has before any candidate draws on it.
+  void SetCapacity(int planet_id, int ships);
+
+  // Adds a candidate and returns its index. Candidates should be added best
+  // first.
+  int AddCandidate(int target, int value);
+
+  // Makes the last candidate take ships from planet_id. It is only possible
+  // while the planet has at least need ships left.
+  void AddUse(int planet_id, int need, int take);
+
+  // Returns the indices of the chosen candidates in increasing order. At
+  // most max_nodes search nodes and budget_ms milliseconds are spent; with
+  // max_nodes 0 this is the greedy answer.
+  void Solve(long max_nodes, double budget_ms, std::vector<int> *chosen);
+
+  // Search nodes visited by the last Solve() and whether it finished.
+  long Nodes() const { return nodes_; }
+  bool Complete() const { return !aborted_; }
+
+ private:
+  struct Candidate {
+    int target;
+    int value;
+    int first_use;
+    int num_uses;
+  };
+
+  struct Use {
+    int planet_id;
+    int need;
+    int take;
+  };
+
+  bool Taken(int target) const {
+    return (taken_[target >> 6] >> (target & 63)) & 1;
+  }
+  void Flip(int target) { taken_[target >> 6] ^= (uint64_t)1 << (target & 63); }
+
+  bool Fits(int c) const;
+  void Apply(int c, int sign);
+  int Bound(int first);
+  void Search(int c, int value);
+  bool OutOfBudget();
+
+  std::vector<Candidate> candidates_;
+  std::vector<Use> uses_;
+  std::vector<int> capacity_;
+  std::vector<uint64_t> taken_;
+
+  // Best value per target seen by Bound(), and the targets it touched.
+  std::vector<int> bound_value_;
+  std::vector<int> bound_targets_;
+
+  std::vector<int> stack_;
+  std::vector<int> best_;
+  int best_value_;
+
+  Timer timer_;
+  double budget_ms_;
+  long max_nodes_;
+  long nodes_;
+  bool aborted_;
+};
+
+#endif
@@ -0,0 +1,150 @@
+#include "SpatialIndex.h"
+#include <algorithm>
+#include <cmath>
+
+SpatialIndex::SpatialIndex()
+    : min_x_(0),
+      min_y_(0),
+      cell_size_(1),
+      width_(0),
+      height_(0) {
+}
+
+void SpatialIndex::Build(const std::vector<double>& positions) {
+  const int n = positions.size() / 2;
+  positions_ = positions;
+  owners_.assign(n, 0);
+  cell_of_.resize(n);
+  planets_.resize(n);
+
+  double max_x = 0, max_y = 0;
+  min_x_ = min_y_ = 0;
+  for (int i = 0; i < n; ++i) {
+    const double x = positions_[2 * i], y = positions_[2 * i + 1];
+    if (i == 0 || x < min_x_) min_x_ = x;
+    if (i == 0 || y < min_y_) min_y_ = y;
+    if (i == 0 || x > max_x) max_x = x;
+    if (i == 0 || y > max_y) max_y = y;
+  }
+
+  // Cells of equal area holding two planets each on average. A map that is
+  // nearly a line gets no more than 4n cells.
+  const double w = std::max(max_x - min_x_, 1e-9);
+  const double h = std::max(max_y - min_y_, 1e-9);
+  cell_size_ = std::max(sqrt(w * h / std::max(n / 2.0, 1.0)), 1e-9);
+  while ((w / cell_size_ + 1) * (h / cell_size_ + 1) > 4.0 * n + 16)
+    cell_size_ *= 2;
+  width_ = (int)(w / cell_size_) + 1;
+  height_ = (int)(h / cell_size_) + 1;
+
+  // Counting sort of the planets by cell.
+  const Cell empty = { 0, { 0, 0, 0 } };
+  cells_.assign(width_ * height_ + 1, empty);
+  for (int i = 0; i < n; ++i) {
+    cell_of_[i] = CellY(positions_[2 * i + 1]) * width_ +
+                  CellX(positions_[2 * i]);
+    cells_[cell_of_[i] + 1].first++;
+    cells_[cell_of_[i]].count[0]++;
+  }
+  for (size_t c = 1; c < cells_.size(); ++c)
+    cells_[c].first += cells_[c - 1].first;
+  std::vector<int> next(cells_.size());
+  for (size_t c = 0; c < cells_.size(); ++c)
+    next[c] = cells_[c].first;
+  for (int i = 0; i < n; ++i)
+    planets_[next[cell_of_[i]]++] = i;
+}
+
+void SpatialIndex::SetOwner(int planet_id, int owner) {
+  Cell& cell = cells_[cell_of_[planet_id]];
+  cell.count[Class(owners_[planet_id])]--;
+  cell.count[Class(owner)]++;
+  owners_[planet_id] = owner;
+}
+
+int SpatialIndex::Turns(double x, double y, int planet_id) const {
+  const double dx = x - positions_[2 * planet_id];
+  const double dy = y - positions_[2 * planet_id + 1];
+  return (int)ceil(sqrt(dx * dx + dy * dy));
+}
+
+int SpatialIndex::CellX(double x) const {
+  const int cx = (int)floor((x - min_x_) / cell_size_);
+  return std::min(std::max(cx, 0), width_ - 1);
+}
+
+int SpatialIndex::CellY(double y) const {
+  const int cy = (int)floor((y - min_y_) / cell_size_);
+  return std::min(std::max(cy, 0), height_ - 1);
+}
+
+void SpatialIndex::Scan(int cx, int cy, double x, double y, int owners,
+                        std::vector<Hit> *hits) const {
+  const int c = cy * width_ + cx;
+  const Cell& cell = cells_[c];
+  if (!((owners & kNeutral && cell.count[0]) ||
+        (owners & kMine && cell.count[1]) ||
+        (owners & kEnemy && cell.count[2])))
+    return;
+  for (int i = cell.first; i < cells_[c + 1].first; ++i) {
+    const int p = planets_[i];
+    if (!(owners & (1 << Class(owners_[p]))))
+      continue;
+    Hit hit = { Turns(x, y, p), p };
+    hits->push_back(hit);
+  }
+}
+
+void SpatialIndex::Nearest(double x, double y, int k, int owners,
+                           std::vector<int> *nearest) const {
+  nearest->clear();
+  if (k <= 0 || owners_.empty())
+    return;
+  // Reused between calls, which is most of the cost on small maps.
+  static thread_local std::vector<Hit> hits;
+  hits.clear();
+  const int cx = CellX(x), cy = CellY(y);
+  const int max_ring = std::max(width_, height_);
+  for (int r = 0; r <= max_ring; ++r) {
+    // Ring r is the square of cells r away from (cx, cy).
+    for (int dy = -r; dy <= r; ++dy) {
+      const int y_cell = cy + dy;
+      if (y_cell < 0 || y_cell >= height_)
+        continue;
+      const int step = (dy == -r || dy == r) ? 1 : 2 * r;
+      for (int dx = -r; dx <= r; dx += std::max(step, 1)) {
+        const int x_cell = cx + dx;
+        if (x_cell >= 0 && x_cell < width_)
+          Scan(x_cell, y_cell, x, y, owners, &hits);
+      }
+    }
+    // Every planet in ring r + 1 and beyond is more than r cells away.
+    if ((int)hits.size() >= k) {
+      std::nth_element(hits.begin(), hits.begin() + k - 1, hits.end());
+      if (r * cell_size_ > hits[k - 1].turns)
+        break;
+    }
+  }
+  const int found = std::min(k, (int)hits.size());
+  std::partial_sort(hits.begin(), hits.begin() + found, hits.end());
+  for (int i = 0; i < found; ++i)
+    nearest->push_back(hits[i].planet_id);
+}
+
+void SpatialIndex::Within(double x, double y, int turns, int owners,
+                          std::vector<int> *within) const {
+  within->clear();
+  if (owners_.empty() || turns < 0)
+    return;
+  static thread_local std::vector<Hit> hits;
+  hits.clear();
+  const int x0 = CellX(x - turns), x1 = CellX(x + turns);
+  const int y0 = CellY(y - turns), y1 = CellY(y + turns);
+  for (int cy = y0; cy <= y1; ++cy) {
+    for (int cx = x0; cx <= x1; ++cx)
+      Scan(cx, cy, x, y, owners, &hits);
+  }
+  std::sort(hits.begin(), hits.end());
+  for (size_t i = 0; i < hits.size() && hits[i].turns <= turns; ++i)
+    within->push_back(hits[i].planet_id);
+}
@@ -0,0 +1,82 @@
+// Finds planets near a point without looking at every planet.
+//
+// Planets are put into a uniform grid of square cells, about two planets
+// to a cell, when the map is first seen. Distances are turns, as in
+// PlanetWars::Distance(), and ties are broken by planet id, so results come
+// out in the same order as a full sort would give. Every cell also counts
+// its planets by owner class, so a search for, say, neutral planets skips
+// cells that have none.
+#ifndef SPATIAL_INDEX_H_
+#define SPATIAL_INDEX_H_
+
+#include <vector>
+
+class SpatialIndex {
+ public:
+  // Owner classes a query can ask for, to be or'ed together.
+  enum Owners {
+    kNeutral = 1,
+    kMine = 2,
+    kEnemy = 4,  // any owner above 1
+    kAnyOwner = 7
+  };
+
+  SpatialIndex();
+
+  // Indexes planets at the given positions, x and y of each planet in
+  // turn. Every planet starts out neutral.
+  void Build(const std::vector<double>& positions);
+
+  int NumPlanets() const { return owners_.size(); }
+
+  // Records the owner of a planet.
+  void SetOwner(int planet_id, int owner);
+
+  // Fills nearest with the k planets of the given owner classes closest to
+  // (x, y), nearest first. Fewer are returned if there are fewer.
+  void Nearest(double x, double y, int k, int owners,
+               std::vector<int> *nearest) const;
+
+  // Fills within with every planet of the given owner classes at most turns
+  // turns from (x, y), nearest first.
+  void Within(double x, double y, int turns, int owners,
+              std::vector<int> *within) const;
+
+ private:
+  struct Cell {
+    int first;           // into planets_
+    int count[3];        // planets of each owner class
+  };
+
+  // A planet found by a search, as its distance and id.
+  struct Hit {
+    int turns;
+    int planet_id;
+
+    bool operator<(const Hit& other) const {
+      if (turns != other.turns)
+        return turns < other.turns;
+      return planet_id < other.planet_id;
+    }
+  };
+
+  static int Class(int owner) { return owner > 2 ? 2 : owner; }
+  int Turns(double x, double y, int planet_id) const;
+  int CellX(double x) const;
+  int CellY(double y) const;
+  // Adds the planets of cell (cx, cy) that match owners to hits.
+  void Scan(int cx, int cy, double x, double y, int owners,
+            std::vector<Hit> *hits) const;
+
+  std::vector<double> positions_;
+  std::vector<int> owners_;
+  std::vector<int> cell_of_;
+  // Planet ids sorted by cell, and each cell's first entry.
+  std::vector<int> planets_;
+  std::vector<Cell> cells_;
+  double min_x_, min_y_;
+  double cell_size_;
+  int width_, height_;
+};
+
+#endif
@@ -0,0 +1,108 @@
+#include "ThreadPool.h"
+
+ThreadPool::ThreadPool()
+    : job_(0),
+      generation_(0),
+      active_(0),
+      stop_(false) {
+  queues_.push_back(new Queue);
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> guard(lock_);
+    stop_ = true;
+  }
+  wake_.notify_all();
+  for (size_t i = 0; i < threads_.size(); ++i)
+    threads_[i].join();
+  for (size_t i = 0; i < queues_.size(); ++i)
+    delete queues_[i];
+}
+
+void ThreadPool::Start(int threads) {
+  while ((int)queues_.size() < threads) {
+    const int worker = queues_.size();
+    queues_.push_back(new Queue);
+    threads_.push_back(std::thread(&ThreadPool::WorkerLoop, this, worker));
+  }
+}
+
+void ThreadPool::Run(int num_tasks, const std::function<void(int, int)>& fn) {
+  const int workers = NumWorkers();
+  if (workers == 1 || num_tasks <= 1) {
+    for (int i = 0; i < num_tasks; ++i)
+      fn(i, 0);
+    return;
+  }
+
+  for (int i = 0; i < num_tasks; ++i) {
+    Queue& queue = *queues_[(long)i * workers / num_tasks];
+    std::lock_guard<std::mutex> guard(queue.lock);
+    queue.tasks.push_back(i);
+  }
+  {
+    std::lock_guard<std::mutex> guard(lock_);
+    job_ = &fn;
+    active_ = workers - 1;
+    ++generation_;
+  }
+  wake_.notify_all();
+
+  Work(0);
+
+  // The queues are empty, but other workers may still be on a task.
+  std::unique_lock<std::mutex> guard(lock_);
+  while (active_ > 0)
+    done_.wait(guard);
+  job_ = 0;
+}
+
+void ThreadPool::WorkerLoop(int worker) {
+  int seen = 0;
+  while (true) {
+    {
+      std::unique_lock<std::mutex> guard(lock_);
+      while (!stop_ && generation_ == seen)
+        wake_.wait(guard);
+      if (stop_)
+        return;
+      seen = generation_;
+    }
+    Work(worker);
+    {
+      std::lock_guard<std::mutex> guard(lock_);
+      if (--active_ == 0)
+        done_.notify_all();
+    }
+  }
+}
+
+void ThreadPool::Work(int worker) {
+  int task;
+  while (Next(worker, &task))
+    (*job_)(task, worker);
+}
+
+bool ThreadPool::Next(int worker, int *task) {
+  {
+    Queue& own = *queues_[worker];
+    std::lock_guard<std::mutex> guard(own.lock);
+    if (!own.tasks.empty()) {
+      *task = own.tasks.front();
+      own.tasks.pop_front();
+      return true;
+    }
+  }
+  const int workers = queues_.size();
+  for (int i = 1; i < workers; ++i) {
+    Queue& victim = *queues_[(worker + i) % workers];
+    std::lock_guard<std::mutex> guard(victim.lock);
+    if (!victim.tasks.empty()) {
+      *task = victim.tasks.back();
+      victim.tasks.pop_back();
+      return true;
+    }
+  }
+  return false;
+}
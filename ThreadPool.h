@@ -0,0 +1,59 @@
+// A fixed set of worker threads that run batches of independent tasks.
+//
+// Run() deals the tasks out evenly, in contiguous runs, to one queue per
+// worker. A worker takes tasks from the front of its own queue and, once
+// that is empty, steals from the back of the others', so a batch with a
+// few slow tasks still finishes together. The thread calling Run() works
+// too, as worker 0.
+#ifndef THREAD_POOL_H_
+#define THREAD_POOL_H_
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class ThreadPool {
+ public:
+  ThreadPool();
+  ~ThreadPool();
+
+  // Starts the pool with threads workers, counting the caller of Run().
+  void Start(int threads);
+
+  int NumWorkers() const { return queues_.size(); }
+
+  // Calls fn(task, worker) for every task in [0, num_tasks) and returns
+  // once all of them have finished. worker is in [0, NumWorkers()) and a
+  // worker runs one task at a time, so per-worker buffers need no locking.
+  // Only one Run() may be in progress at a time.
+  void Run(int num_tasks, const std::function<void(int, int)>& fn);
+
+ private:
+  struct Queue {
+    std::mutex lock;
+    std::deque<int> tasks;
+  };
+
+  void WorkerLoop(int worker);
+  void Work(int worker);
+  bool Next(int worker, int *task);
+
+  std::vector<std::thread> threads_;
+  std::vector<Queue *> queues_;
+
+  std::mutex lock_;
+  std::condition_variable wake_;
+  std::condition_variable done_;
+  const std::function<void(int, int)> *job_;
+  int generation_;
+  int active_;
+  bool stop_;
+
+  ThreadPool(const ThreadPool&);
+  void operator=(const ThreadPool&);
+};
+
+#endif
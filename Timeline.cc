@@ -0,0 +1,72 @@
+#include "Timeline.h"
+#include "FixedGameState.h"
+#include <algorithm>
+
+Timeline::Timeline() : horizon_(0) {
+}
+
+template <class State>
+void Timeline::Build(const State& state, const MapGeometry& map,
+                     int horizon) {
+  const int n = state.NumPlanets();
+  const int stride = horizon + 1;
+  horizon_ = horizon;
+  growth_rates_.resize(n);
+  owners_.resize(n * stride);
+  ships_.resize(n * stride);
+
+  arrivals_.clear();
+  for (int i = 0; i < state.NumFleets(); ++i) {
+    const FleetState& f = state.GetFleet(i);
+    if (f.turns_remaining > horizon)
+      continue;
+    Arrival a = { f.destination_planet, f.turns_remaining, f.owner,
+                  f.num_ships };
+    arrivals_.push_back(a);
+  }
+  std::sort(arrivals_.begin(), arrivals_.end());
+
+  Battle battle;
+  size_t next = 0;
+  for (int p = 0; p < n; ++p) {
+    const int growth = map.GrowthRate(p);
+    int owner = state.GetPlanet(p).owner;
+    int ships = state.GetPlanet(p).num_ships;
+    growth_rates_[p] = growth;
+    owners_[p * stride] = owner;
+    ships_[p * stride] = ships;
+    for (int t = 1; t <= horizon; ++t) {
+      if (owner != 0)
+        ships += growth;
+      if (next < arrivals_.size() && arrivals_[next].planet_id == p &&
+          arrivals_[next].turn == t) {
+        battle.Reset(owner, ships);
+        for (; next < arrivals_.size() && arrivals_[next].planet_id == p &&
+               arrivals_[next].turn == t; ++next)
+          battle.Add(arrivals_[next].owner, arrivals_[next].num_ships);
+        battle.Resolve(&owner, &ships);
+      }
+      owners_[p * stride + t] = owner;
+      ships_[p * stride + t] = ships;
+    }
+  }
+}
+
+template void Timeline::Build(const GameState&, const MapGeometry&, int);
+template void Timeline::Build(const SmallGameState&, const MapGeometry&, int);
+template void Timeline::Build(const LargeGameState&, const MapGeometry&, int);
+
+int Timeline::Owner(int planet_id, int turns) const {
+  return owners_[planet_id * (horizon_ + 1) + std::min(turns, horizon_)];
+}
+
+int Timeline::Ships(int planet_id, int turns) const {
+  const int stride = horizon_ + 1;
+  if (turns <= horizon_)
+    return ships_[planet_id * stride + turns];
+  int owner = owners_[planet_id * stride + horizon_];
+  int ships = ships_[planet_id * stride + horizon_];
+  if (owner != 0)
+    ships += (turns - horizon_) * growth_rates_[planet_id];
+  return ships;
+}
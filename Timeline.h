@@ -0,0 +1,49 @@
+// Where every planet is headed if nobody issues another order: the owner and
+// ship count of each planet on each of the next few turns, worked out from
+// the fleets already in flight.
+#ifndef TIMELINE_H_
+#define TIMELINE_H_
+
+#include <vector>
+
+class GameState;
+class MapGeometry;
+
+class Timeline {
+ public:
+  Timeline();
+
+  // Projects state forward horizon turns. Fleets that land after the
+  // horizon are ignored. State is GameState or one of the FixedGameStates.
+  template <class State>
+  void Build(const State& state, const MapGeometry& map, int horizon);
+
+  int Horizon() const { return horizon_; }
+
+  // The owner and ships of planet_id turns turns from now (0 is now). Past
+  // the horizon a planet keeps its owner and keeps growing.
+  int Owner(int planet_id, int turns) const;
+  int Ships(int planet_id, int turns) const;
+
+ private:
+  struct Arrival {
+    int planet_id;
+    int turn;
+    int owner;
+    int num_ships;
+
+    bool operator<(const Arrival& other) const {
+      if (planet_id != other.planet_id)
+        return planet_id < other.planet_id;
+      return turn < other.turn;
+    }
+  };
+
+  int horizon_;
+  std::vector<int> growth_rates_;
+  std::vector<int> owners_;
+  std::vector<int> ships_;
+  std::vector<Arrival> arrivals_;
+};
+
+#endif
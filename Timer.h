@@ -0,0 +1,24 @@
+// Wall clock time since a point in the turn, for staying inside the turn
+// budget.
+#ifndef TIMER_H_
+#define TIMER_H_
+
+#include <chrono>
+
+class Timer {
+ public:
+  Timer() { Start(); }
+
+  void Start() { start_ = std::chrono::steady_clock::now(); }
+
+  // Milliseconds since the timer was started.
+  double ElapsedMs() const {
+    return std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - start_).count();
+  }
+
+ private:
+  std::chrono::steady_clock::time_point start_;
+};
+
+#endif
@@ -0,0 +1,58 @@
+#include "TranspositionTable.h"
+
+TranspositionTable::TranspositionTable(int log2_slots)
+    : slots_(new Slot[(uint64_t)1 << log2_slots]),
+      mask_(((uint64_t)1 << log2_slots) - 1) {
+  Clear();
+}
+
+TranspositionTable::~TranspositionTable() {
+  delete[] slots_;
+}
+
+void TranspositionTable::Clear() {
+  for (uint64_t i = 0; i <= mask_; ++i) {
+    slots_[i].key.store(0, std::memory_order_relaxed);
+    slots_[i].data.store(0, std::memory_order_relaxed);
+  }
+}
+
+// Layout of the data word, low bits first:
+//   32 bits score, 8 bits depth, 2 bits bound, 16 bits best move + 1,
+//   and the top bit set so that a stored entry is never all zeroes.
+uint64_t TranspositionTable::Pack(const Entry& entry) {
+  return ((uint64_t)1 << 63) | (uint64_t)(uint32_t)entry.score |
+         ((uint64_t)(entry.depth & 0xff) << 32) |
+         ((uint64_t)(entry.bound & 0x3) << 40) |
+         ((uint64_t)((entry.best_move + 1) & 0xffff) << 42);
+}
+
+TranspositionTable::Entry TranspositionTable::Unpack(uint64_t data) {
+  Entry entry;
+  entry.score = (int32_t)(uint32_t)data;
+  entry.depth = (data >> 32) & 0xff;
+  entry.bound = (Bound)((data >> 40) & 0x3);
+  entry.best_move = (int)((data >> 42) & 0xffff) - 1;
+  return entry;
+}
+
+bool TranspositionTable::Probe(uint64_t hash, Entry *entry) const {
+  const Slot& slot = slots_[hash & mask_];
+  uint64_t data = slot.data.load(std::memory_order_relaxed);
+  uint64_t key = slot.key.load(std::memory_order_relaxed);
+  if ((key ^ data) != hash || data == 0)
+    return false;
+  *entry = Unpack(data);
+  return true;
+}
+
+void TranspositionTable::Store(uint64_t hash, const Entry& entry) {
+  Slot& slot = slots_[hash & mask_];
+  uint64_t old = slot.data.load(std::memory_order_relaxed);
+  uint64_t old_key = slot.key.load(std::memory_order_relaxed);
+  if ((old_key ^ old) == hash && Unpack(old).depth > entry.depth)
+    return;
+  uint64_t data = Pack(entry);
+  slot.key.store(hash ^ data, std::memory_order_relaxed);
+  slot.data.store(data, std::memory_order_relaxed);
+}
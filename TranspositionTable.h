@@ -0,0 +1,59 @@
+// A fixed-size hash table of search results keyed by GameState::Hash().
+//
+// The table is shared by every search thread without locks. Each slot is a
+// pair of 64-bit atomics holding the packed result and the hash xor'ed with
+// it. A reader that sees a slot half way through being overwritten gets a
+// key that does not match and treats it as a miss, so torn entries are never
+// returned.
+#ifndef TRANSPOSITION_TABLE_H_
+#define TRANSPOSITION_TABLE_H_
+
+#include <atomic>
+#include <stdint.h>
+
+class TranspositionTable {
+ public:
+  // How a stored score relates to the true value of the position.
+  enum Bound { kExact = 0, kLower = 1, kUpper = 2 };
+
+  struct Entry {
+    int score;
+    int depth;
+    Bound bound;
+    // Index of the best move in the move generator's order, or -1.
+    int best_move;
+  };
+
+  // Creates a table with 2^log2_slots slots, 16 bytes each.
+  explicit TranspositionTable(int log2_slots);
+  ~TranspositionTable();
+
+  // Forgets every stored result.
+  void Clear();
+
+  // Looks up hash. Returns true and fills entry if the table holds it.
+  bool Probe(uint64_t hash, Entry *entry) const;
+
+  // Stores a result. A slot holding another position is always replaced; a
+  // slot holding the same position keeps whichever result searched deeper.
+  void Store(uint64_t hash, const Entry& entry);
+
+  int NumSlots() const { return mask_ + 1; }
+
+ private:
+  struct Slot {
+    std::atomic<uint64_t> key;
+    std::atomic<uint64_t> data;
+  };
+
+  static uint64_t Pack(const Entry& entry);
+  static Entry Unpack(uint64_t data);
+
+  Slot *slots_;
+  uint64_t mask_;
+
+  TranspositionTable(const TranspositionTable&);
+  void operator=(const TranspositionTable&);
+};
+
+#endif
@@ -0,0 +1,40 @@
+// Zobrist style keys for GameState.
+//
+// Ship counts are not bounded, so instead of a table of random numbers each
+// key is a 64-bit mix of the feature it describes. A state's hash is the sum
+// (mod 2^64) of the keys of its planets and fleets. A sum rather than the
+// usual xor is used because two identical fleets must not cancel out.
+//
+// Fleets are keyed by the turn they arrive rather than by turns remaining,
+// so advancing a turn only changes the keys of planets that grow or fight
+// and of fleets that land.
+#ifndef ZOBRIST_H_
+#define ZOBRIST_H_
+
+#include <stdint.h>
+
+namespace Zobrist {
+
+// splitmix64 finalizer.
+inline uint64_t Mix(uint64_t x) {
+  x += 0x9e3779b97f4a7c15ULL;
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+  return x ^ (x >> 31);
+}
+
+inline uint64_t PlanetKey(int planet_id, int owner, int num_ships) {
+  return Mix(((uint64_t)1 << 62) | ((uint64_t)planet_id << 32) |
+             ((uint64_t)owner << 16) | (uint64_t)num_ships);
+}
+
+inline uint64_t FleetKey(int owner, int num_ships, int destination_planet,
+                         int arrival_turn) {
+  return Mix(((uint64_t)2 << 62) | ((uint64_t)(owner & 0x3fff) << 48) |
+             ((uint64_t)arrival_turn << 32) |
+             ((uint64_t)destination_planet << 16) | (uint64_t)num_ships);
+}
+
+}  // namespace Zobrist
+
+#endif
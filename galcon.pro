@@ -11,7 +11,14 @@ win32|os2: CONFIG += console
 mac:CONFIG -= app_bundle
 
 QT -= core gui
+CONFIG += thread
 
 # Input
-HEADERS += PlanetWars.h
-SOURCES += MyBot.cc PlanetWars.cc
+HEADERS += PlanetWars.h Params.h GameState.h Zobrist.h TranspositionTable.h \
+           Timer.h Timeline.h Endgame.h ThreadPool.h Selection.h Influence.h \
+           SpatialIndex.h FixedGameState.h OpeningBook.h \
+           FleetTracker.h MapPack.h PerfCounters.h Evaluator.h
+SOURCES += MyBot.cc PlanetWars.cc Params.cc GameState.cc TranspositionTable.cc \
+           Timeline.cc Endgame.cc ThreadPool.cc Selection.cc Influence.cc \
+           SpatialIndex.cc OpeningBook.cc FleetTracker.cc MapPack.cc \
+           PerfCounters.cc Evaluator.cc
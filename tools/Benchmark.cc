@@ -0,0 +1,1230 @@
+// Measures how the bot's building blocks scale with the size of the map.
+//
+//   make benchmark
+//   ./benchmark spatial sizes=1000,10000,100000 queries=2000
+//   ./benchmark spatial state=big.txt
+//   ./benchmark batch games=1024 turns=200 check=64
+//   ./benchmark maps pack=maps.pack
+//   ./benchmark fleets fleets=2000
+//   ./benchmark eval positions=256
+//   ./benchmark batch counters=1
+//   ./benchmark startup bot=./MyBot runs=20 delays=0,100
+//   ./benchmark parse fleets turn sizes=1000,5000 state=big.txt runs=3
+//
+// Each suite prints one line per map as space separated name=value pairs.
+// The first line of a suite is always the bundled maps in maps/, then come
+// the states given with state= (see tools/MapGen.cc) and random states of
+// the requested sizes made by the same generator, with fleets= fleets in
+// flight. The batch suite plays whole games and the eval suite scores
+// positions made up on the maps (see Evaluator.h), so both leave out the
+// random states. The maps suite only times the bundled maps, set up from
+// their text and from the map pack. The startup suite runs the bot itself
+// on maps/map1.txt, with and without its warm-up (see Warmup() in
+// MyBot.cc), once for every delay between starting the bot and sending it
+// the first state; the turn suite runs it on the other states instead, with
+// nothing bundled.
+//
+// With counters=1 every suite is followed by a line with its hardware
+// counters (see PerfCounters.h), or counters=none where there are none.
+
+#include "Generator.h"
+#include "../Evaluator.h"
+#include "../GameBatch.h"
+#include "../GameState.h"
+#include "../MapPack.h"
+#include "../Params.h"
+#include "../PerfCounters.h"
+#include "../PlanetWars.h"
+#include "../SpatialIndex.h"
+#include "../Timeline.h"
+#include "../Timer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <csignal>
+#include <cstring>
+#include <random>
+#include <sstream>
+#include <string>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+struct Options {
+  std::vector<std::string> suites;
+  std::vector<std::string> states;
+  std::vector<int> sizes;
+  int queries;
+  unsigned seed;
+  int games;
+  int turns;
+  int check;
+  std::string pack;
+  bool counters;
+  std::string bot;
+  int runs;
+  std::vector<int> delays;
+  int fleets;
+  int positions;
+
+  Options()
+      : queries(2000), seed(1), games(1024), turns(200), check(64),
+        pack("maps.pack"), counters(false), bot("./MyBot"), runs(20),
+        fleets(1000), positions(256) {
+    sizes.push_back(1000);
+    sizes.push_back(10000);
+    sizes.push_back(100000);
+    delays.push_back(0);
+    delays.push_back(100);
+  }
+};
+
+// A map reduced to what the benchmarks need.
+struct Layout {
+  std::string name;
+  std::vector<double> positions;  // x and y of each planet
+  std::vector<int> owners;
+
+  int NumPlanets() const { return owners.size(); }
+};
+
+Layout ToLayout(const std::string& name, const GeneratedState& state) {
+  Layout layout;
+  layout.name = name;
+  for (size_t i = 0; i < state.planets.size(); ++i) {
+    layout.positions.push_back(state.planets[i].x);
+    layout.positions.push_back(state.planets[i].y);
+    layout.owners.push_back(state.planets[i].owner);
+  }
+  return layout;
+}
+
+bool ReadState(const std::string& file, GeneratedState *state) {
+  std::ifstream in(file.c_str());
+  if (!in)
+    return false;
+  std::stringstream text;
+  text << in.rdbuf();
+  return state->Parse(text.str());
+}
+
+// Reads maps/map1.txt to maps/map100.txt.
+std::vector<Layout> BundledMaps() {
+  std::vector<Layout> layouts;
+  for (int m = 1; m <= 100; ++m) {
+    std::stringstream name;
+    name << "maps/map" << m << ".txt";
+    GeneratedState state;
+    if (ReadState(name.str(), &state))
+      layouts.push_back(ToLayout(name.str(), state));
+  }
+  return layouts;
+}
+
+// The states named by state= options.
+std::vector<Layout> StateFiles(const Options& options) {
+  std::vector<Layout> layouts;
+  for (size_t i = 0; i < options.states.size(); ++i) {
+    GeneratedState state;
+    if (ReadState(options.states[i], &state))
+      layouts.push_back(ToLayout(options.states[i], state));
+    else
+      std::cerr << "Cannot read " << options.states[i] << std::endl;
+  }
+  return layouts;
+}
+
+std::string RandomName(int num_planets) {
+  std::stringstream name;
+  name << "random" << num_planets;
+  return name.str();
+}
+
+GeneratedState RandomState(int num_planets, int fleets,
+                           const Options& options) {
+  GeneratorOptions generator;
+  generator.planets = num_planets;
+  generator.fleets = fleets;
+  generator.seed = options.seed;
+  GeneratedState state;
+  GenerateState(generator, &state);
+  return state;
+}
+
+Layout RandomMap(int num_planets, const Options& options) {
+  return ToLayout(RandomName(num_planets),
+                  RandomState(num_planets, 0, options));
+}
+
+// A state a suite runs on, as the engine would send it.
+struct NamedState {
+  std::string name;
+  std::string text;
+  int planets;
+};
+
+int CountPlanets(const std::string& text) {
+  int planets = 0;
+  for (size_t begin = 0, end; begin < text.size(); begin = end + 1) {
+    end = text.find('\n', begin);
+    if (end == std::string::npos)
+      end = text.size();
+    planets += text[begin] == 'P';
+  }
+  return planets;
+}
+
+// The states named by state= options, then random states of the requested
+// sizes with fleets fleets in flight.
+std::vector<NamedState> ExtraStates(const Options& options, int fleets) {
+  std::vector<NamedState> states;
+  for (size_t i = 0; i < options.states.size(); ++i) {
+    std::ifstream in(options.states[i].c_str());
+    std::stringstream text;
+    text << in.rdbuf();
+    if (!in) {
+      std::cerr << "Cannot read " << options.states[i] << std::endl;
+      continue;
+    }
+    NamedState state = { options.states[i], text.str(),
+                         CountPlanets(text.str()) };
+    states.push_back(state);
+  }
+  for (size_t i = 0; i < options.sizes.size(); ++i) {
+    const std::string text =
+        RandomState(options.sizes[i], fleets, options).ToString();
+    NamedState state = { RandomName(options.sizes[i]), text,
+                         CountPlanets(text) };
+    states.push_back(state);
+  }
+  return states;
+}
+
+int Turns(const Layout& layout, int a, int b) {
+  const double dx = layout.positions[2 * a] - layout.positions[2 * b];
+  const double dy = layout.positions[2 * a + 1] - layout.positions[2 * b + 1];
+  return (int)ceil(sqrt(dx * dx + dy * dy));
+}
+
+// The nearest neutral planet, found by looking at every one.
+int LinearNearestEmpty(const Layout& layout, int planet_id) {
+  int nearest = -1;
+  int nearest_id = -1;
+  for (int i = 0; i < layout.NumPlanets(); ++i) {
+    if (layout.owners[i] != 0)
+      continue;
+    int d = Turns(layout, planet_id, i);
+    if (nearest == -1 || nearest > d) {
+      nearest_id = i;
+      nearest = d;
+    }
+  }
+  return nearest_id;
+}
+
+// Our k planets nearest to planet_id, found by looking at every one.
+void LinearNearestMine(const Layout& layout, int planet_id, int k,
+                       std::vector<int> *nearest) {
+  std::vector<std::pair<int, int> > hits;
+  for (int i = 0; i < layout.NumPlanets(); ++i) {
+    if (layout.owners[i] == 1)
+      hits.push_back(std::make_pair(Turns(layout, planet_id, i), i));
+  }
+  k = std::min(k, (int)hits.size());
+  std::partial_sort(hits.begin(), hits.begin() + k, hits.end());
+  nearest->clear();
+  for (int i = 0; i < k; ++i)
+    nearest->push_back(hits[i].second);
+}
+
+// The layout as a state PlanetWars can read, every planet with ten ships
+// growing by one.
+std::string LayoutText(const Layout& layout) {
+  std::string text;
+  char line[128];
+  for (int i = 0; i < layout.NumPlanets(); ++i) {
+    snprintf(line, sizeof(line), "P %.6f %.6f %d 10 1\n",
+             layout.positions[2 * i], layout.positions[2 * i + 1],
+             layout.owners[i]);
+    text += line;
+  }
+  return text;
+}
+
+// Times building the index and answering queries on a set of layouts,
+// and checks the nearest neutral planet against a linear scan. The pw_
+// figures go through PlanetWars the way the planner does: pw_build_ms reads
+// the state, index and influence map included, and pw_sources_us and
+// pw_within_us are the offensive and defensive source lookups, our planets
+// nearest first, all of them or those within reach. The planner's lookups
+// are checked against a linear scan too. A map with more planets than
+// PlanetWars reads is only timed reading.
+void SpatialSuite(const std::string& name, const std::vector<Layout>& layouts,
+                  const Options& options, std::mt19937& rng) {
+  const int kNeighbors = 8;
+  const int kRadius = 10;
+  double build_ms = 0, nearest_ms = 0, knn_ms = 0, within_ms = 0;
+  double linear_ms = 0, pw_build_ms = 0, pw_sources_ms = 0, pw_within_ms = 0;
+  long queries = 0, found = 0, mismatches = 0;
+  int planets = 0;
+
+  std::vector<int> result;
+  for (size_t l = 0; l < layouts.size(); ++l) {
+    const Layout& layout = layouts[l];
+    planets = std::max(planets, layout.NumPlanets());
+    SpatialIndex index;
+    Timer timer;
+    index.Build(layout.positions);
+    for (int i = 0; i < layout.NumPlanets(); ++i)
+      index.SetOwner(i, layout.owners[i]);
+    build_ms += timer.ElapsedMs();
+
+    const int n = std::max(1, options.queries / (int)layouts.size());
+    std::uniform_int_distribution<int> pick(0, layout.NumPlanets() - 1);
+    std::vector<int> sources(n);
+    for (int q = 0; q < n; ++q)
+      sources[q] = pick(rng);
+    queries += n;
+
+    std::vector<int> nearest(n);
+    timer.Start();
+    for (int q = 0; q < n; ++q) {
+      const int p = sources[q];
+      index.Nearest(layout.positions[2 * p], layout.positions[2 * p + 1], 1,
+                    SpatialIndex::kNeutral, &result);
+      nearest[q] = result.empty() ? -1 : result[0];
+    }
+    nearest_ms += timer.ElapsedMs();
+
+    timer.Start();
+    for (int q = 0; q < n; ++q) {
+      const int p = sources[q];
+      index.Nearest(layout.positions[2 * p], layout.positions[2 * p + 1],
+                    kNeighbors, SpatialIndex::kMine, &result);
+      found += result.size();
+    }
+    knn_ms += timer.ElapsedMs();
+
+    timer.Start();
+    for (int q = 0; q < n; ++q) {
+      const int p = sources[q];
+      index.Within(layout.positions[2 * p], layout.positions[2 * p + 1],
+                   kRadius, SpatialIndex::kAnyOwner, &result);
+      found += result.size();
+    }
+    within_ms += timer.ElapsedMs();
+
+    timer.Start();
+    for (int q = 0; q < n; ++q) {
+      if (LinearNearestEmpty(layout, sources[q]) != nearest[q])
+        ++mismatches;
+    }
+    linear_ms += timer.ElapsedMs();
+
+    timer.Start();
+    const PlanetWars pw(LayoutText(layout));
+    pw_build_ms += timer.ElapsedMs();
+    if (pw.NumPlanets() != layout.NumPlanets())
+      continue;
+
+    timer.Start();
+    for (int q = 0; q < n; ++q) {
+      pw.NearestPlanets(sources[q], pw.NumPlanets(), SpatialIndex::kMine,
+                        &result);
+      found += result.size();
+    }
+    pw_sources_ms += timer.ElapsedMs();
+
+    timer.Start();
+    for (int q = 0; q < n; ++q) {
+      pw.PlanetsWithin(sources[q], kRadius, SpatialIndex::kMine, &result);
+      found += result.size();
+    }
+    pw_within_ms += timer.ElapsedMs();
+
+    std::vector<int> expected;
+    for (int q = 0; q < n; ++q) {
+      pw.NearestPlanets(sources[q], kNeighbors, SpatialIndex::kMine, &result);
+      LinearNearestMine(layout, sources[q], kNeighbors, &expected);
+      mismatches += result != expected;
+    }
+  }
+
+  const double us = 1000.0 / std::max(queries, 1L);
+  printf("spatial map=%s maps=%d planets=%d build_ms=%.3f nearest_us=%.3f "
+         "knn%d_us=%.3f within%d_us=%.3f linear_us=%.3f pw_build_ms=%.3f "
+         "pw_sources_us=%.3f pw_within%d_us=%.3f found=%ld mismatches=%ld\n",
+         name.c_str(), (int)layouts.size(), planets,
+         build_ms / layouts.size(), nearest_ms * us, kNeighbors, knn_ms * us,
+         kRadius, within_ms * us, linear_ms * us,
+         pw_build_ms / layouts.size(), pw_sources_ms * us, kRadius,
+         pw_within_ms * us, found, mismatches);
+  fflush(stdout);
+}
+
+void Spatial(const Options& options) {
+  std::mt19937 rng(options.seed);
+  SpatialSuite("bundled", BundledMaps(), options, rng);
+  std::vector<Layout> layouts = StateFiles(options);
+  for (size_t i = 0; i < options.sizes.size(); ++i)
+    layouts.push_back(RandomMap(options.sizes[i], options));
+  for (size_t i = 0; i < layouts.size(); ++i)
+    SpatialSuite(layouts[i].name, std::vector<Layout>(1, layouts[i]), options,
+                 rng);
+}
+
+// A map the batch suite plays on, with the state games start from.
+struct Arena {
+  std::string name;
+  MapGeometry map;
+  GameState start;
+};
+
+bool TextArena(const std::string& name, const std::string& text,
+               std::vector<Arena> *arenas) {
+  const PlanetWars pw(text);
+  if (pw.NumPlanets() == 0)
+    return false;
+  Arena arena = { name, MapGeometry(pw), GameState(pw) };
+  arenas->push_back(arena);
+  return true;
+}
+
+bool ReadArena(const std::string& file, std::vector<Arena> *arenas) {
+  std::ifstream in(file.c_str());
+  if (!in)
+    return false;
+  std::stringstream text;
+  text << in.rdbuf();
+  return TextArena(file, text.str(), arenas);
+}
+
+// Which of its choices a planet makes in one game on one turn, spread so
+// that games started from the same state soon play differently.
+inline int Choice(uint32_t game, uint32_t turn, uint32_t planet,
+                  uint32_t player, uint32_t choices) {
+  uint32_t h = game * 0x9e3779b1u ^ turn * 0x85ebca6bu ^
+               planet * 0xc2b2ae35u ^ player * 0x27d4eb2fu;
+  h ^= h >> 15;
+  h *= 0x2c1b3c6du;
+  h ^= h >> 13;
+  return ((h >> 16) * choices) >> 16;
+}
+
+// Every planet with enough ships sends half of them to one of its nearest
+// planets, picked at random. Simple, but it makes fleets, captures and
+// battles on every map.
+class RandomNeighbors {
+ public:
+  static const int kChoices = 3;
+  static const int kMinShips = 20;
+
+  explicit RandomNeighbors(const MapGeometry& map) : map_(map) {
+    const int n = map.NumPlanets();
+    for (int p = 0; p < n; ++p) {
+      std::vector<std::pair<int, int> > by_distance;
+      for (int q = 0; q < n; ++q) {
+        if (q != p)
+          by_distance.push_back(std::make_pair(map.Distance(p, q), q));
+      }
+      std::sort(by_distance.begin(), by_distance.end());
+      for (int k = 0; k < kChoices; ++k)
+        neighbors_.push_back(by_distance[k % by_distance.size()].second);
+    }
+  }
+
+  int Neighbor(int planet_id, int k) const {
+    return neighbors_[planet_id * kChoices + k];
+  }
+
+  // The same decisions for one game held in a GameState.
+  void Orders(int player, int game, GameState& state) const {
+    for (int p = 0; p < state.NumPlanets(); ++p) {
+      const PlanetState& planet = state.GetPlanet(p);
+      if (planet.owner != player || planet.num_ships < kMinShips)
+        continue;
+      const int k = Choice(game, state.Turn(), p, player, kChoices);
+      state.IssueOrder(map_, p, Neighbor(p, k), planet.num_ships / 2);
+    }
+  }
+
+ private:
+  const MapGeometry& map_;
+  std::vector<int> neighbors_;
+};
+
+class RandomNeighborsBatch : public BatchPolicy {
+ public:
+  explicit RandomNeighborsBatch(const RandomNeighbors& policy)
+      : policy_(policy) {}
+
+  void Orders(int player, GameBatch& batch) {
+    const int games = batch.NumGames();
+    const uint32_t turn = batch.Turn();
+    choices_.resize(games);
+    ships_.resize(games);
+    int32_t *choice = &choices_[0];
+    int32_t *send = &ships_[0];
+    for (int p = 0; p < batch.NumPlanets(); ++p) {
+      const int32_t *owners = batch.Owners(p);
+      const int32_t *ships = batch.Ships(p);
+      int32_t senders = 0;
+      for (int g = 0; g < games; ++g) {
+        const bool ready =
+            owners[g] == player && ships[g] >= RandomNeighbors::kMinShips;
+        choice[g] = ready ? Choice(g, turn, p, player,
+                                   RandomNeighbors::kChoices) : -1;
+        senders += ready;
+      }
+      if (senders == 0)
+        continue;
+      for (int k = 0; k < RandomNeighbors::kChoices; ++k) {
+        for (int g = 0; g < games; ++g)
+          send[g] = choice[g] == k ? ships[g] / 2 : 0;
+        batch.Send(player, p, policy_.Neighbor(p, k), send);
+      }
+    }
+  }
+
+ private:
+  const RandomNeighbors& policy_;
+  std::vector<int32_t> choices_;
+  std::vector<int32_t> ships_;
+};
+
+// Whether game g of batch is where state is: planets and ships by player.
+bool SameGame(const GameBatch& batch, int g, const GameState& state) {
+  for (int p = 0; p < state.NumPlanets(); ++p) {
+    if (batch.Owners(p)[g] != state.GetPlanet(p).owner ||
+        batch.Ships(p)[g] != state.GetPlanet(p).num_ships)
+      return false;
+  }
+  return true;
+}
+
+// Plays games of the random neighbors policy against itself on each arena,
+// all at once in a GameBatch and the first check of them one by one in
+// GameStates, and checks they end the same.
+void BatchSuite(const std::string& name, const std::vector<Arena>& arenas,
+                const Options& options) {
+  double batch_ms = 0, scalar_ms = 0;
+  long batch_turns = 0, scalar_turns = 0, mismatches = 0;
+  long wins[3] = { 0, 0, 0 };
+  int planets = 0;
+
+  for (size_t a = 0; a < arenas.size(); ++a) {
+    const Arena& arena = arenas[a];
+    planets = std::max(planets, arena.map.NumPlanets());
+    const RandomNeighbors policy(arena.map);
+    RandomNeighborsBatch batch_policy(policy);
+    GameBatch batch(arena.map, options.games);
+    if (!batch.Reset(arena.start)) {
+      std::cerr << "Cannot batch " << arena.name << std::endl;
+      continue;
+    }
+    Timer timer;
+    batch.Play(batch_policy, batch_policy, options.turns);
+    batch_ms += timer.ElapsedMs();
+    batch_turns += (long)options.games * options.turns;
+
+    std::vector<int32_t> ships1(options.games), ships2(options.games);
+    batch.TotalShips(1, &ships1[0]);
+    batch.TotalShips(2, &ships2[0]);
+    for (int g = 0; g < options.games; ++g)
+      ++wins[ships1[g] > ships2[g] ? 1 : ships2[g] > ships1[g] ? 2 : 0];
+
+    const int check = std::min(options.check, options.games);
+    std::vector<GameState> states(check, arena.start);
+    timer.Start();
+    for (int g = 0; g < check; ++g) {
+      for (int t = 0; t < options.turns; ++t) {
+        policy.Orders(1, g, states[g]);
+        policy.Orders(2, g, states[g]);
+        states[g].AdvanceTurn(arena.map);
+      }
+    }
+    scalar_ms += timer.ElapsedMs();
+    scalar_turns += (long)check * options.turns;
+    for (int g = 0; g < check; ++g) {
+      if (!SameGame(batch, g, states[g]))
+        ++mismatches;
+    }
+  }
+
+  const double batch_rate = batch_turns / std::max(batch_ms, 1e-3) * 1000;
+  const double scalar_rate = scalar_turns / std::max(scalar_ms, 1e-3) * 1000;
+  printf("batch map=%s maps=%d planets=%d games=%d turns=%d batch_ms=%.1f "
+         "game_turns_per_sec_core=%.0f scalar_game_turns_per_sec_core=%.0f "
+         "checked=%ld mismatches=%ld wins1=%ld wins2=%ld draws=%ld\n",
+         name.c_str(), (int)arenas.size(), planets, options.games,
+         options.turns, batch_ms, batch_rate, scalar_rate,
+         scalar_turns / options.turns, mismatches, wins[1], wins[2], wins[0]);
+  fflush(stdout);
+}
+
+void Batch(const Options& options) {
+  std::vector<Arena> arenas;
+  for (int m = 1; m <= 100; ++m) {
+    std::stringstream name;
+    name << "maps/map" << m << ".txt";
+    ReadArena(name.str(), &arenas);
+  }
+  BatchSuite("bundled", arenas, options);
+  for (size_t i = 0; i < options.states.size(); ++i) {
+    std::vector<Arena> state;
+    if (ReadArena(options.states[i], &state))
+      BatchSuite(options.states[i], state, options);
+    else
+      std::cerr << "Cannot read " << options.states[i] << std::endl;
+  }
+}
+
+// The start of arena with fleets more fleets in flight, sent by players 1
+// and 2 between random planets and somewhere along their way.
+GameState HeavyFleets(const Arena& arena, int fleets, std::mt19937& rng) {
+  const int n = arena.map.NumPlanets();
+  std::uniform_int_distribution<int> pick(0, n - 1);
+  std::uniform_int_distribution<int> ships(1, 50);
+  std::stringstream text;
+  text << arena.start.ToString(arena.map);
+  for (int i = 0; i < fleets; ++i) {
+    const int source = pick(rng);
+    int destination = pick(rng);
+    if (destination == source)
+      destination = (source + 1) % n;
+    const int trip = arena.map.Distance(source, destination);
+    std::uniform_int_distribution<int> remaining(1, trip);
+    text << "F " << 1 + i % 2 << " " << ships(rng) << " " << source << " "
+         << destination << " " << trip << " " << remaining(rng) << "\n";
+  }
+  return GameState(PlanetWars(text.str()));
+}
+
+// Times the per-planet queries, playing the fleets out and the timeline
+// of a state full of fleets, and how much of the playing out merging the
+// fleets that land together saves. groups is the fleets left after the
+// merge; mismatches counts planets that end up differently.
+void FleetsSuite(const std::string& name, const std::vector<Arena>& arenas,
+                 const Options& options) {
+  const int kRounds = 10;
+  std::mt19937 rng(options.seed);
+  double stats_ms = 0, advance_ms = 0, coalesce_ms = 0, merged_ms = 0;
+  double timeline_ms = 0, merged_timeline_ms = 0;
+  long planets = 0, groups = 0, mismatches = 0;
+
+  for (size_t a = 0; a < arenas.size(); ++a) {
+    const Arena& arena = arenas[a];
+    const MapGeometry& map = arena.map;
+    const GameState state = HeavyFleets(arena, options.fleets, rng);
+    const int turns = map.MaxDistance();
+    const PlanetWars pw(state.ToString(map));
+    planets += map.NumPlanets();
+
+    // Each change of a planet's ships works its queries out again.
+    Timer timer;
+    for (int r = 0; r < kRounds; ++r) {
+      for (int p = 0; p < pw.NumPlanets(); ++p)
+        pw.removeShips(p, 0);
+    }
+    stats_ms += timer.ElapsedMs();
+
+    GameState played, merged;
+    Timeline timeline, merged_timeline;
+    for (int r = 0; r < kRounds; ++r) {
+      timer.Start();
+      played.CopyFrom(state);
+      for (int t = 0; t < turns; ++t)
+        played.AdvanceTurn(map);
+      advance_ms += timer.ElapsedMs();
+
+      timer.Start();
+      merged.CopyFrom(state);
+      merged.CoalesceFleets();
+      coalesce_ms += timer.ElapsedMs();
+      for (int t = 0; t < turns; ++t)
+        merged.AdvanceTurn(map);
+      merged_ms += timer.ElapsedMs();
+
+      timer.Start();
+      timeline.Build(state, map, turns);
+      timeline_ms += timer.ElapsedMs();
+      merged.CopyFrom(state);
+      merged.CoalesceFleets();
+      timer.Start();
+      merged_timeline.Build(merged, map, turns);
+      merged_timeline_ms += timer.ElapsedMs();
+    }
+    groups += merged.NumFleets();
+
+    merged.CopyFrom(state);
+    merged.CoalesceFleets();
+    for (int t = 0; t < turns; ++t)
+      merged.AdvanceTurn(map);
+    for (int p = 0; p < map.NumPlanets(); ++p) {
+      mismatches += played.GetPlanet(p).owner != merged.GetPlanet(p).owner ||
+                    played.GetPlanet(p).num_ships !=
+                        merged.GetPlanet(p).num_ships ||
+                    timeline.Owner(p, turns) !=
+                        merged_timeline.Owner(p, turns) ||
+                    timeline.Ships(p, turns) !=
+                        merged_timeline.Ships(p, turns);
+    }
+  }
+
+  const long maps = std::max<size_t>(1, arenas.size());
+  const double per_map = 1000.0 / (kRounds * maps);
+  printf("fleets map=%s maps=%d planets=%ld fleets=%d groups=%ld "
+         "stats_us=%.3f "
+         "advance_us=%.2f coalesced_advance_us=%.2f coalesce_us=%.2f "
+         "timeline_us=%.2f coalesced_timeline_us=%.2f mismatches=%ld\n",
+         name.c_str(), (int)arenas.size(), planets / maps, options.fleets,
+         groups / maps,
+         stats_ms * 1000.0 / (kRounds * std::max(planets, 1L)),
+         advance_ms * per_map, merged_ms * per_map, coalesce_ms * per_map,
+         timeline_ms * per_map, merged_timeline_ms * per_map, mismatches);
+  fflush(stdout);
+}
+
+void Fleets(const Options& options) {
+  std::vector<Arena> arenas;
+  for (int m = 1; m <= 100; ++m) {
+    std::stringstream name;
+    name << "maps/map" << m << ".txt";
+    ReadArena(name.str(), &arenas);
+  }
+  FleetsSuite("bundled", arenas, options);
+  // The suite adds its own fleets.
+  const std::vector<NamedState> states = ExtraStates(options, 0);
+  for (size_t i = 0; i < states.size(); ++i) {
+    std::vector<Arena> state;
+    if (TextArena(states[i].name, states[i].text, &state))
+      FleetsSuite(states[i].name, state, options);
+    else
+      std::cerr << "Cannot read " << states[i].name << std::endl;
+  }
+}
+
+// Reads text into pw the way the bot reads a turn.
+void ParseInto(const std::string& text, PlanetWars *pw) {
+  pw->BeginState();
+  for (size_t begin = 0, end; begin < text.size(); begin = end + 1) {
+    end = text.find('\n', begin);
+    if (end == std::string::npos)
+      end = text.size();
+    pw->ParseLine(text.data() + begin, end - begin);
+  }
+  pw->EndState();
+}
+
+// Times reading states into PlanetWars. parse_us reads each into a new
+// one, which sets up the spatial index and influence map from scratch.
+// turn_us reads it into one that has already seen the map, alternating
+// with the state a turn later, the way the bot goes from turn to turn.
+// Both are per state.
+void ParseSuite(const std::string& name,
+                const std::vector<std::string>& texts) {
+  const int kRounds = 5;
+  std::vector<std::string> next(texts.size());
+  long planets = 0, fleets = 0;
+  for (size_t i = 0; i < texts.size(); ++i) {
+    const PlanetWars pw(texts[i]);
+    const MapGeometry map(pw);
+    GameState state(pw);
+    state.AdvanceTurn(map);
+    next[i] = state.ToString(map);
+    planets += pw.NumPlanets();
+    fleets += pw.NumFleets();
+  }
+
+  double parse_ms = 0;
+  for (int r = 0; r < kRounds; ++r) {
+    for (size_t i = 0; i < texts.size(); ++i) {
+      Timer timer;
+      const PlanetWars pw(texts[i]);
+      parse_ms += timer.ElapsedMs();
+    }
+  }
+
+  double turn_ms = 0;
+  for (size_t i = 0; i < texts.size(); ++i) {
+    PlanetWars pw(texts[i]);
+    for (int r = 0; r < kRounds; ++r) {
+      Timer timer;
+      ParseInto(next[i], &pw);
+      ParseInto(texts[i], &pw);
+      turn_ms += timer.ElapsedMs();
+    }
+  }
+
+  const double us = 1000.0 / (kRounds * texts.size());
+  printf("parse map=%s maps=%d planets=%ld fleets=%ld parse_us=%.2f "
+         "turn_us=%.2f\n",
+         name.c_str(), (int)texts.size(), planets / (long)texts.size(),
+         fleets / (long)texts.size(), parse_ms * us, turn_ms * us / 2);
+  fflush(stdout);
+}
+
+void Parse(const Options& options) {
+  std::vector<std::string> texts;
+  for (int m = 1; m <= 100; ++m) {
+    std::stringstream name;
+    name << "maps/map" << m << ".txt";
+    std::ifstream in(name.str().c_str());
+    std::stringstream text;
+    text << in.rdbuf();
+    if (in)
+      texts.push_back(text.str());
+  }
+  if (!texts.empty())
+    ParseSuite("bundled", texts);
+  const std::vector<NamedState> states = ExtraStates(options, options.fleets);
+  for (size_t i = 0; i < states.size(); ++i)
+    ParseSuite(states[i].name, std::vector<std::string>(1, states[i].text));
+}
+
+// A position on arena's map with every planet given to a random owner and
+// ship count, and fleets fleets of players 1 and 2 in flight.
+GameState RandomPosition(const Arena& arena, int fleets, std::mt19937& rng) {
+  const int n = arena.map.NumPlanets();
+  std::uniform_int_distribution<int> owner(0, 2);
+  std::uniform_int_distribution<int> ships(0, 200);
+  std::uniform_int_distribution<int> pick(0, n - 1);
+  std::stringstream text;
+  for (int p = 0; p < n; ++p) {
+    text.precision(17);
+    text << "P " << arena.map.X(p) << " " << arena.map.Y(p) << " "
+         << owner(rng) << " " << ships(rng) << " "
+         << arena.map.GrowthRate(p) << "\n";
+  }
+  for (int i = 0; i < fleets; ++i) {
+    const int source = pick(rng);
+    const int destination = (source + 1 + pick(rng) % (n - 1)) % n;
+    const int trip = arena.map.Distance(source, destination);
+    std::uniform_int_distribution<int> remaining(1, trip);
+    text << "F " << 1 + i % 2 << " " << 1 + ships(rng) << " " << source
+         << " " << destination << " " << trip << " " << remaining(rng)
+         << "\n";
+  }
+  return GameState(PlanetWars(text.str()));
+}
+
+// The leaf score the endgame search used before Evaluator, which the
+// default weights must match.
+int ReferenceScore(const MapGeometry& map, const GameState& state,
+                   int growth_turns) {
+  int ships = 0, growth = 0;
+  for (int p = 0; p < state.NumPlanets(); ++p) {
+    const PlanetState& planet = state.GetPlanet(p);
+    if (planet.owner == 0)
+      continue;
+    const int sign = planet.owner == 1 ? 1 : -1;
+    ships += sign * planet.num_ships;
+    growth += sign * map.GrowthRate(p);
+  }
+  for (int i = 0; i < state.NumFleets(); ++i) {
+    const FleetState& f = state.GetFleet(i);
+    ships += f.owner == 1 ? f.num_ships : -f.num_ships;
+  }
+  return ships + growth * growth_turns;
+}
+
+// Evaluations per second of made-up positions with 16 fleets in flight,
+// with the default weights, with every feature weighed and with
+// ReferenceScore(), and how often the default weights disagree with
+// ReferenceScore().
+void EvalSuite(const std::string& name, const std::vector<Arena>& arenas,
+               const Options& options) {
+  const int kRounds = 20;
+  const int kFleets = 16;
+  const int kGrowthTurns = 10;
+  std::mt19937 rng(options.seed);
+  Params all;
+  all.eval_pressure = 100;
+  all.eval_projected = 100;
+  double default_ms = 0, all_ms = 0, reference_ms = 0;
+  long evaluations = 0, mismatches = 0, checksum = 0;
+  int planets = 0;
+
+  for (size_t a = 0; a < arenas.size(); ++a) {
+    const Arena& arena = arenas[a];
+    planets = std::max(planets, arena.map.NumPlanets());
+    std::vector<GameState> positions;
+    for (int i = 0; i < options.positions; ++i)
+      positions.push_back(RandomPosition(arena, kFleets, rng));
+
+    Evaluator evaluator;
+    evaluator.SetMap(arena.map);
+    for (size_t i = 0; i < positions.size(); ++i) {
+      mismatches += evaluator.Evaluate(positions[i], kGrowthTurns) !=
+                    ReferenceScore(arena.map, positions[i], kGrowthTurns);
+    }
+    Timer timer;
+    for (int r = 0; r < kRounds; ++r) {
+      for (size_t i = 0; i < positions.size(); ++i)
+        checksum += evaluator.Evaluate(positions[i], kGrowthTurns);
+    }
+    default_ms += timer.ElapsedMs();
+
+    timer.Start();
+    for (int r = 0; r < kRounds; ++r) {
+      for (size_t i = 0; i < positions.size(); ++i)
+        checksum -= ReferenceScore(arena.map, positions[i], kGrowthTurns);
+    }
+    reference_ms += timer.ElapsedMs();
+
+    evaluator.SetWeights(all);
+    timer.Start();
+    for (int r = 0; r < kRounds; ++r) {
+      for (size_t i = 0; i < positions.size(); ++i)
+        checksum += evaluator.Evaluate(positions[i], kGrowthTurns);
+    }
+    all_ms += timer.ElapsedMs();
+    evaluations += (long)kRounds * positions.size();
+  }
+
+  const double ns = 1e6 / std::max(evaluations, 1L);
+  printf("eval map=%s maps=%d planets=%d positions=%d default_ns=%.1f "
+         "default_meval_s=%.2f all_ns=%.1f all_meval_s=%.2f "
+         "reference_ns=%.1f checksum=%ld mismatches=%ld\n",
+         name.c_str(), (int)arenas.size(), planets, options.positions,
+         default_ms * ns, evaluations / std::max(default_ms, 1e-3) / 1000,
+         all_ms * ns, evaluations / std::max(all_ms, 1e-3) / 1000,
+         reference_ms * ns, checksum, mismatches);
+  fflush(stdout);
+}
+
+void Eval(const Options& options) {
+  std::vector<Arena> arenas;
+  for (int m = 1; m <= 100; ++m) {
+    std::stringstream name;
+    name << "maps/map" << m << ".txt";
+    ReadArena(name.str(), &arenas);
+  }
+  EvalSuite("bundled", arenas, options);
+  for (size_t i = 0; i < options.states.size(); ++i) {
+    std::vector<Arena> state;
+    if (ReadArena(options.states[i], &state))
+      EvalSuite(options.states[i], state, options);
+    else
+      std::cerr << "Cannot read " << options.states[i] << std::endl;
+  }
+}
+
+// Times what a process does before its first turn on each bundled map,
+// starting from the map's text: parse it and work out the geometry, either
+// from scratch or from the map pack. Also checks the two agree.
+void Maps(const Options& options) {
+  std::vector<std::string> texts;
+  for (int m = 1; m <= 100; ++m) {
+    std::stringstream name;
+    name << "maps/map" << m << ".txt";
+    std::ifstream in(name.str().c_str());
+    if (!in)
+      continue;
+    std::stringstream text;
+    text << in.rdbuf();
+    texts.push_back(text.str());
+  }
+  if (texts.empty())
+    return;
+  const int kRounds = 20;
+
+  double text_ms = 0;
+  for (int r = 0; r < kRounds; ++r) {
+    for (size_t i = 0; i < texts.size(); ++i) {
+      Timer timer;
+      const PlanetWars pw(texts[i]);
+      const MapGeometry geometry(pw);
+      text_ms += timer.ElapsedMs();
+    }
+  }
+
+  Timer timer;
+  MapPack pack;
+  if (!pack.Open(options.pack)) {
+    std::cerr << "Cannot open " << options.pack << std::endl;
+    return;
+  }
+  const double open_ms = timer.ElapsedMs();
+  double pack_ms = 0;
+  long found = 0;
+  for (int r = 0; r < kRounds; ++r) {
+    for (size_t i = 0; i < texts.size(); ++i) {
+      Timer timer;
+      const PlanetWars pw(texts[i]);
+      const int map = pack.Find(MapGeometry::HashLayout(pw));
+      const MapGeometry geometry =
+          map >= 0 ? MapGeometry(pack, map) : MapGeometry(pw);
+      pack_ms += timer.ElapsedMs();
+      found += map >= 0;
+    }
+  }
+
+  long mismatches = 0;
+  for (size_t i = 0; i < texts.size(); ++i) {
+    const PlanetWars text_pw(texts[i]);
+    const MapGeometry text_geometry(text_pw);
+    const int map = pack.Find(text_geometry.LayoutHash());
+    if (map < 0)
+      continue;
+    const MapGeometry pack_geometry(pack, map);
+    for (int p = 0; p < text_pw.NumPlanets(); ++p) {
+      for (int q = 0; q < text_pw.NumPlanets(); ++q)
+        mismatches +=
+            text_geometry.Distance(p, q) != pack_geometry.Distance(p, q);
+    }
+  }
+
+  const double us = 1000.0 / (kRounds * texts.size());
+  printf("maps map=bundled maps=%d pack_maps=%d text_us=%.2f pack_us=%.2f "
+         "open_us=%.2f found=%ld mismatches=%ld\n",
+         (int)texts.size(), pack.NumMaps(), text_ms * us, pack_ms * us,
+         open_ms * 1000, found / kRounds, mismatches);
+  fflush(stdout);
+}
+
+// When one start of a bot answered, in ms since it was started.
+struct StartupTimes {
+  double sent_ms;   // the first state was sent
+  double first_ms;  // the first line, an order or "go", came back
+  double go_ms;     // the first turn was over
+};
+
+// Starts command, sends it state after delay_ms and waits for its first
+// turn. Returns false if the bot could not be started or gave no "go".
+bool TimeStartup(const std::string& command, const std::string& state,
+                 int delay_ms, StartupTimes *times) {
+  int to_bot[2], from_bot[2];
+  if (pipe(to_bot) != 0)
+    return false;
+  if (pipe(from_bot) != 0) {
+    close(to_bot[0]);
+    close(to_bot[1]);
+    return false;
+  }
+  Timer timer;
+  const pid_t pid = fork();
+  if (pid == 0) {
+    dup2(to_bot[0], STDIN_FILENO);
+    dup2(from_bot[1], STDOUT_FILENO);
+    close(to_bot[0]);
+    close(to_bot[1]);
+    close(from_bot[0]);
+    close(from_bot[1]);
+    execl("/bin/sh", "sh", "-c", ("exec " + command).c_str(), (char *)0);
+    _exit(127);
+  }
+  close(to_bot[0]);
+  close(from_bot[1]);
+  FILE *in = fdopen(to_bot[1], "w");
+  FILE *out = fdopen(from_bot[0], "r");
+  bool ok = pid > 0 && in && out;
+  if (ok) {
+    usleep(delay_ms * 1000);
+    times->sent_ms = timer.ElapsedMs();
+    ok = fputs(state.c_str(), in) >= 0 && fputs("go\n", in) >= 0 &&
+         fflush(in) == 0;
+  }
+  times->first_ms = -1;
+  char line[256];
+  while (ok && fgets(line, sizeof(line), out)) {
+    if (times->first_ms < 0)
+      times->first_ms = timer.ElapsedMs();
+    if (strncmp(line, "go", 2) == 0)
+      break;
+  }
+  times->go_ms = timer.ElapsedMs();
+  ok = ok && times->first_ms >= 0 && strncmp(line, "go", 2) == 0;
+  // The bot quits when its input ends.
+  if (in)
+    fclose(in);
+  if (out)
+    fclose(out);
+  if (pid > 0) {
+    if (!ok)
+      kill(pid, SIGTERM);
+    waitpid(pid, 0, 0);
+  }
+  return ok;
+}
+
+double Median(std::vector<double> values) {
+  std::sort(values.begin(), values.end());
+  return values[values.size() / 2];
+}
+
+// How long the bot takes from being started to its first order, as an
+// engine sees it: first_ms from the exec to the first line of the first
+// turn, response_ms from sending the state to that line and turn_ms from
+// sending the state to "go". Medians over the runs, with the worst
+// response.
+void Startup(const Options& options) {
+  std::ifstream in("maps/map1.txt");
+  std::stringstream text;
+  text << in.rdbuf();
+  if (!in) {
+    std::cerr << "Cannot read maps/map1.txt" << std::endl;
+    return;
+  }
+  for (size_t d = 0; d < options.delays.size(); ++d) {
+    for (int warmup = 0; warmup <= 1; ++warmup) {
+      std::stringstream command;
+      command << options.bot << " warmup=" << warmup;
+      std::vector<double> first, response, turn;
+      for (int r = 0; r < options.runs; ++r) {
+        StartupTimes times;
+        if (!TimeStartup(command.str(), text.str(), options.delays[d],
+                         &times)) {
+          std::cerr << "No first turn from " << command.str() << std::endl;
+          return;
+        }
+        first.push_back(times.first_ms);
+        response.push_back(times.first_ms - times.sent_ms);
+        turn.push_back(times.go_ms - times.sent_ms);
+      }
+      printf("startup warmup=%d delay_ms=%d runs=%d first_ms=%.2f "
+             "response_ms=%.2f max_response_ms=%.2f turn_ms=%.2f\n",
+             warmup, options.delays[d], options.runs, Median(first),
+             Median(response),
+             *std::max_element(response.begin(), response.end()),
+             Median(turn));
+      fflush(stdout);
+    }
+  }
+}
+
+// How long the bot takes over its first turn on each state other than the
+// bundled maps: response_ms from sending the state to the first line back
+// and turn_ms to "go", medians over the runs. The bot starts without its
+// warm-up, which would still be running when the state arrives.
+void Turn(const Options& options) {
+  const std::string command = options.bot + " warmup=0";
+  const std::vector<NamedState> states = ExtraStates(options, options.fleets);
+  for (size_t i = 0; i < states.size(); ++i) {
+    std::vector<double> response, turn;
+    for (int r = 0; r < options.runs; ++r) {
+      StartupTimes times;
+      if (!TimeStartup(command, states[i].text, 0, &times)) {
+        std::cerr << "No first turn from " << command << " on "
+                  << states[i].name << std::endl;
+        return;
+      }
+      response.push_back(times.first_ms - times.sent_ms);
+      turn.push_back(times.go_ms - times.sent_ms);
+    }
+    printf("turn map=%s planets=%d runs=%d response_ms=%.2f turn_ms=%.2f\n",
+           states[i].name.c_str(), states[i].planets, options.runs,
+           Median(response), Median(turn));
+    fflush(stdout);
+  }
+}
+
+bool ParseOption(const std::string& arg, Options& options) {
+  std::string::size_type eq = arg.find('=');
+  if (eq == std::string::npos) {
+    options.suites.push_back(arg);
+    return arg == "spatial" || arg == "batch" || arg == "maps" ||
+           arg == "startup" || arg == "fleets" || arg == "eval" ||
+           arg == "parse" || arg == "turn";
+  }
+  const std::string name = arg.substr(0, eq);
+  const std::string value = arg.substr(eq + 1);
+  if (name == "sizes") {
+    options.sizes.clear();
+    std::stringstream list(value);
+    std::string size;
+    while (std::getline(list, size, ','))
+      options.sizes.push_back(std::max(1, atoi(size.c_str())));
+  } else if (name == "state") {
+    options.states.push_back(value);
+  } else if (name == "queries") {
+    options.queries = std::max(1, atoi(value.c_str()));
+  } else if (name == "seed") {
+    options.seed = strtoul(value.c_str(), 0, 10);
+  } else if (name == "games") {
+    options.games = std::max(1, atoi(value.c_str()));
+  } else if (name == "turns") {
+    options.turns = std::max(1, atoi(value.c_str()));
+  } else if (name == "check") {
+    options.check = std::max(0, atoi(value.c_str()));
+  } else if (name == "pack") {
+    options.pack = value;
+  } else if (name == "counters") {
+    options.counters = atoi(value.c_str()) != 0;
+  } else if (name == "fleets") {
+    options.fleets = std::max(0, atoi(value.c_str()));
+  } else if (name == "positions") {
+    options.positions = std::max(1, atoi(value.c_str()));
+  } else if (name == "bot") {
+    options.bot = value;
+  } else if (name == "runs") {
+    options.runs = std::max(1, atoi(value.c_str()));
+  } else if (name == "delays") {
+    options.delays.clear();
+    std::stringstream list(value);
+    std::string delay;
+    while (std::getline(list, delay, ','))
+      options.delays.push_back(std::max(0, atoi(delay.c_str())));
+  } else {
+    return false;
+  }
+  return true;
+}
+
+}  // namespace
+
+int main(int argc, char *argv[]) {
+  Options options;
+  for (int i = 1; i < argc; ++i) {
+    if (!ParseOption(argv[i], options)) {
+      std::cerr << "Unknown option: " << argv[i] << std::endl;
+      return 1;
+    }
+  }
+  if (options.suites.empty())
+    options.suites.push_back("spatial");
+
+  PerfCounters counters;
+  const bool counting = options.counters && counters.Open();
+  for (size_t i = 0; i < options.suites.size(); ++i) {
+    PerfCounters::Values before, after;
+    counters.Read(&before);
+    Timer timer;
+    if (options.suites[i] == "spatial")
+      Spatial(options);
+    else if (options.suites[i] == "batch")
+      Batch(options);
+    else if (options.suites[i] == "maps")
+      Maps(options);
+    else if (options.suites[i] == "startup")
+      Startup(options);
+    else if (options.suites[i] == "fleets")
+      Fleets(options);
+    else if (options.suites[i] == "eval")
+      Eval(options);
+    else if (options.suites[i] == "parse")
+      Parse(options);
+    else if (options.suites[i] == "turn")
+      Turn(options);
+    if (!options.counters)
+      continue;
+    const double ms = timer.ElapsedMs();
+    counters.Read(&after);
+    for (int c = 0; c < PerfCounters::kNumCounters; ++c)
+      after.counts[c] -= before.counts[c];
+    printf("counters suite=%s ms=%.1f", options.suites[i].c_str(), ms);
+    if (counting)
+      counters.Write(stdout, after);
+    else
+      printf(" counters=none");
+    printf("\n");
+    fflush(stdout);
+  }
+  return 0;
+}
@@ -0,0 +1,512 @@
+// Turns game logs into a column store (see LogStore.h) and reports on it.
+//
+//   make gamelog
+//   ./gamelog ingest store=games vis_output log.txt results.log
+//   ./gamelog report store=games step=25
+//
+// ingest works out which of these each file is from its first line:
+//   vis_output  PlayGame's standard output, which ShowGame reads: each
+//               planet as "x,y,owner,ships,growth" joined by ':', then '|',
+//               then one entry per turn joined by ':'. An entry is
+//               "owner.ships" for each planet followed by
+//               "owner.ships.source.destination.trip.left" for each fleet,
+//               joined by ','.
+//   log.txt     PlayGame's log file. The state sent to player 1 after each
+//               "engine > player1:" gives the turn; "playerN > engine:"
+//               lines are counted as orders.
+//   native      One record per line, for our own engines and simulators:
+//                 map NAME
+//                 turn
+//                 P x y owner ships growth
+//                 F owner ships source destination trip left
+//                 order PLAYER source destination ships
+//                 time PLAYER MS
+//                 result WINNER
+//               "turn" starts a snapshot and "result" (0 for a draw) ends
+//               the game, so a file can hold any number of games.
+// Games without a result are scored as the engine would at the end of the
+// game: whoever has ships left, or more ships if both do. A game is filed
+// under the map of maps/ with the same layout, else under its native map
+// name, else under its layout hash.
+//
+// report prints the win rate of player 1, percentiles of the turn times,
+// the mean ship difference by turn and a line per map, as name=value pairs.
+
+#include "LogStore.h"
+#include "../GameState.h"
+#include "../MapPack.h"
+#include "../PlanetWars.h"
+#include "../Timer.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct Options {
+  std::string command;
+  std::string store;
+  std::vector<std::string> files;
+  int step;
+
+  Options() : store("games"), step(25) {}
+};
+
+// A game read from a log, before it is added to the store.
+struct Game {
+  std::string map;
+  std::vector<double> positions;  // x and y of each planet
+  std::vector<TurnSnapshot> turns;
+  int winner;
+
+  Game() : winner(-1) {}
+};
+
+// Layout hashes of the bundled maps, from maps.pack if it is there.
+class MapNames {
+ public:
+  MapNames() {
+    MapPack pack;
+    if (pack.Open("maps.pack")) {
+      for (int m = 0; m < pack.NumMaps(); ++m) {
+        const std::string name = pack.Name(m);
+        names_[pack.LayoutHash(m)] = name.substr(0, name.rfind(".txt"));
+      }
+      return;
+    }
+    for (int m = 1; m <= 100; ++m) {
+      std::stringstream name;
+      name << "maps/map" << m << ".txt";
+      std::ifstream in(name.str().c_str());
+      if (!in)
+        continue;
+      std::stringstream text;
+      text << in.rdbuf();
+      std::stringstream short_name;
+      short_name << "map" << m;
+      names_[MapGeometry::HashLayout(PlanetWars(text.str()))] =
+          short_name.str();
+    }
+  }
+
+  std::string Name(const Game& game) const {
+    std::string text;
+    char line[128];
+    const TurnSnapshot& first = game.turns[0];
+    for (size_t i = 0; i < first.planets.size(); ++i) {
+      snprintf(line, sizeof(line), "P %.17g %.17g 0 0 %d\n",
+               game.positions[2 * i], game.positions[2 * i + 1],
+               first.planets[i].growth_rate);
+      text += line;
+    }
+    const uint64_t hash = MapGeometry::HashLayout(PlanetWars(text));
+    std::map<uint64_t, std::string>::const_iterator it = names_.find(hash);
+    if (it != names_.end())
+      return it->second;
+    if (!game.map.empty())
+      return game.map;
+    snprintf(line, sizeof(line), "layout-%016llx", (unsigned long long)hash);
+    return line;
+  }
+
+ private:
+  std::map<uint64_t, std::string> names_;
+};
+
+// The engine's verdict on the last turn: a player with nothing left has
+// lost, and at the turn limit more ships wins.
+int Winner(const TurnSnapshot& turn) {
+  long ships[3] = { 0, 0, 0 };
+  bool alive[3] = { false, false, false };
+  for (size_t i = 0; i < turn.planets.size(); ++i) {
+    const int owner = turn.planets[i].owner;
+    if (owner == 1 || owner == 2) {
+      alive[owner] = true;
+      ships[owner] += turn.planets[i].num_ships;
+    }
+  }
+  for (size_t i = 0; i < turn.fleets.size(); ++i) {
+    const int owner = turn.fleets[i].owner;
+    if (owner == 1 || owner == 2) {
+      alive[owner] = true;
+      ships[owner] += turn.fleets[i].num_ships;
+    }
+  }
+  if (alive[1] != alive[2])
+    return alive[1] ? 1 : 2;
+  return ships[1] > ships[2] ? 1 : (ships[2] > ships[1] ? 2 : 0);
+}
+
+// Reads up to n integers separated by sep from s. Returns the number read.
+int ParseInts(const char *s, char sep, int *values, int n) {
+  int count = 0;
+  while (count < n) {
+    char *end;
+    values[count] = strtol(s, &end, 10);
+    if (end == s)
+      break;
+    ++count;
+    if (*end != sep)
+      break;
+    s = end + 1;
+  }
+  return count;
+}
+
+bool ParsePlanetLine(const char *s, Game& game, TurnSnapshot& turn) {
+  double x, y;
+  SnapshotPlanet p;
+  if (sscanf(s, "P %lf %lf %d %d %d", &x, &y, &p.owner, &p.num_ships,
+             &p.growth_rate) != 5)
+    return false;
+  if (game.turns.size() == 1) {
+    game.positions.push_back(x);
+    game.positions.push_back(y);
+  }
+  turn.planets.push_back(p);
+  return true;
+}
+
+bool ParseFleetLine(const char *s, TurnSnapshot& turn) {
+  SnapshotFleet f;
+  if (sscanf(s, "F %d %d %d %d %d %d", &f.owner, &f.num_ships,
+             &f.source_planet, &f.destination_planet, &f.total_trip_length,
+             &f.turns_remaining) != 6)
+    return false;
+  turn.fleets.push_back(f);
+  return true;
+}
+
+bool ReadVisOutput(std::istream& in, std::vector<Game> *games) {
+  Game game;
+  game.turns.push_back(TurnSnapshot());
+  std::vector<int> growth;
+  std::string token;
+  // The planets, up to the '|'.
+  std::string header;
+  if (!std::getline(in, header, '|'))
+    return false;
+  std::stringstream planets(header);
+  while (std::getline(planets, token, ':')) {
+    double x, y;
+    SnapshotPlanet p;
+    if (sscanf(token.c_str(), "%lf,%lf,%d,%d,%d", &x, &y, &p.owner,
+               &p.num_ships, &p.growth_rate) != 5)
+      return false;
+    game.positions.push_back(x);
+    game.positions.push_back(y);
+    game.turns[0].planets.push_back(p);
+    growth.push_back(p.growth_rate);
+  }
+  const size_t num_planets = growth.size();
+
+  // Then a turn at a time, so the playback is never held whole.
+  while (std::getline(in, token, ':')) {
+    TurnSnapshot turn;
+    const char *s = token.c_str();
+    while (*s && *s != '\n') {
+      int v[6];
+      const int n = ParseInts(s, '.', v, 6);
+      if (turn.planets.size() < num_planets && n == 2) {
+        SnapshotPlanet p = { v[0], v[1], growth[turn.planets.size()] };
+        turn.planets.push_back(p);
+      } else if (n == 6) {
+        SnapshotFleet f = { v[0], v[1], v[2], v[3], v[4], v[5] };
+        turn.fleets.push_back(f);
+      } else {
+        return false;
+      }
+      s = strchr(s, ',');
+      if (!s)
+        break;
+      ++s;
+    }
+    if (turn.planets.size() == num_planets)
+      game.turns.push_back(turn);
+  }
+  games->push_back(game);
+  return true;
+}
+
+bool ReadEngineLog(std::istream& in, std::vector<Game> *games) {
+  Game game;
+  std::string line;
+  bool in_state = false;
+  while (std::getline(in, line)) {
+    const char *s = line.c_str();
+    if (strncmp(s, "engine > player", 15) == 0) {
+      in_state = strncmp(s, "engine > player1:", 17) == 0;
+      if (!in_state)
+        continue;
+      game.turns.push_back(TurnSnapshot());
+      game.turns.back().orders[0] = game.turns.back().orders[1] = 0;
+      s += 17;
+      while (*s == ' ')
+        ++s;
+    } else if (strncmp(s, "player", 6) == 0 && strstr(s, "> engine:")) {
+      in_state = false;
+      const int player = atoi(s + 6);
+      const char *order = strstr(s, "> engine:") + 9;
+      while (*order == ' ')
+        ++order;
+      if (!game.turns.empty() && (player == 1 || player == 2) &&
+          strncmp(order, "go", 2) != 0)
+        game.turns.back().orders[player - 1]++;
+      continue;
+    }
+    if (!in_state)
+      continue;
+    if (s[0] == 'P')
+      ParsePlanetLine(s, game, game.turns.back());
+    else if (s[0] == 'F')
+      ParseFleetLine(s, game.turns.back());
+    else if (strncmp(s, "go", 2) == 0)
+      in_state = false;
+  }
+  if (game.turns.empty())
+    return false;
+  games->push_back(game);
+  return true;
+}
+
+bool ReadNativeLog(std::istream& in, std::vector<Game> *games) {
+  Game game;
+  std::string line;
+  while (std::getline(in, line)) {
+    const char *s = line.c_str();
+    if (strncmp(s, "map ", 4) == 0) {
+      game.map = s + 4;
+    } else if (strncmp(s, "turn", 4) == 0) {
+      game.turns.push_back(TurnSnapshot());
+    } else if (game.turns.empty()) {
+      continue;
+    } else if (s[0] == 'P') {
+      ParsePlanetLine(s, game, game.turns.back());
+    } else if (s[0] == 'F') {
+      ParseFleetLine(s, game.turns.back());
+    } else if (strncmp(s, "order ", 6) == 0) {
+      const int player = atoi(s + 6);
+      if (player == 1 || player == 2) {
+        int& orders = game.turns.back().orders[player - 1];
+        orders = std::max(orders, 0) + 1;
+      }
+    } else if (strncmp(s, "time ", 5) == 0) {
+      int player;
+      float ms;
+      if (sscanf(s + 5, "%d %f", &player, &ms) == 2 &&
+          (player == 1 || player == 2))
+        game.turns.back().turn_ms[player - 1] = ms;
+    } else if (strncmp(s, "result ", 7) == 0) {
+      game.winner = atoi(s + 7);
+      games->push_back(game);
+      game = Game();
+    }
+  }
+  if (!game.turns.empty())
+    games->push_back(game);
+  return true;
+}
+
+// Reads every game in file. Returns false if the file cannot be read.
+bool ReadGames(const std::string& file, LogSource *source,
+               std::vector<Game> *games) {
+  std::ifstream in(file.c_str());
+  if (!in)
+    return false;
+  // The first characters are enough to tell the formats apart.
+  char start[32] = { 0 };
+  in.read(start, sizeof(start) - 1);
+  in.clear();
+  in.seekg(0);
+  if (strncmp(start, "engine >", 8) == 0 || strncmp(start, "player", 6) == 0) {
+    *source = kEngineLog;
+    return ReadEngineLog(in, games);
+  }
+  if ((isdigit(start[0]) || start[0] == '-' || start[0] == '.') &&
+      strchr(start, ',')) {
+    *source = kVisOutput;
+    return ReadVisOutput(in, games);
+  }
+  *source = kNativeLog;
+  return ReadNativeLog(in, games);
+}
+
+int Ingest(const Options& options) {
+  LogWriter writer;
+  if (!writer.Open(options.store)) {
+    std::cerr << "Cannot open store " << options.store << std::endl;
+    return 1;
+  }
+  MapNames names;
+  Timer timer;
+  long num_games = 0, num_turns = 0;
+  for (size_t i = 0; i < options.files.size(); ++i) {
+    std::vector<Game> games;
+    LogSource source = kNativeLog;
+    if (!ReadGames(options.files[i], &source, &games)) {
+      std::cerr << "Cannot read " << options.files[i] << std::endl;
+      continue;
+    }
+    for (size_t g = 0; g < games.size(); ++g) {
+      Game& game = games[g];
+      if (game.turns.empty() || game.turns[0].planets.empty())
+        continue;
+      if (game.winner < 0)
+        game.winner = Winner(game.turns.back());
+      writer.AddGame(names.Name(game), source, game.turns, game.winner);
+      ++num_games;
+      num_turns += game.turns.size();
+    }
+  }
+  if (!writer.Close()) {
+    std::cerr << "Cannot write to " << options.store << std::endl;
+    return 1;
+  }
+  printf("ingest games=%ld turns=%ld ms=%.1f\n", num_games, num_turns,
+         timer.ElapsedMs());
+  return 0;
+}
+
+// The p-th percentile of values, which are reordered.
+double Percentile(std::vector<float>& values, double p) {
+  if (values.empty())
+    return 0;
+  const size_t k = std::min(values.size() - 1,
+                            (size_t)(p / 100 * values.size()));
+  std::nth_element(values.begin(), values.begin() + k, values.end());
+  return values[k];
+}
+
+void ReportTimes(const char *player, const Column<float>& ms,
+                 const LogReader& store) {
+  std::vector<float> times;
+  for (int64_t g = 0; g < store.NumGames(); ++g) {
+    const int64_t first = store.game_first_turn[g];
+    for (int t = 0; t < store.game_num_turns[g]; ++t) {
+      const float v = ms[first + t];
+      if (v >= 0)
+        times.push_back(v);
+    }
+  }
+  if (times.empty()) {
+    printf("time player=%s turns=0\n", player);
+    return;
+  }
+  const double p50 = Percentile(times, 50), p90 = Percentile(times, 90);
+  const double p99 = Percentile(times, 99), max = Percentile(times, 100);
+  printf("time player=%s turns=%zu p50_ms=%.2f p90_ms=%.2f p99_ms=%.2f "
+         "max_ms=%.2f\n", player, times.size(), p50, p90, p99, max);
+}
+
+int Report(const Options& options) {
+  LogReader store;
+  if (!store.Open(options.store)) {
+    std::cerr << "Cannot open store " << options.store << std::endl;
+    return 1;
+  }
+  Timer timer;
+  struct MapStats {
+    long games, wins, draws, turns, final_diff;
+  };
+  std::vector<MapStats> maps(store.NumMaps());
+  std::fill(maps.begin(), maps.end(), MapStats());
+  std::vector<double> diff_sum;
+  std::vector<long> diff_games;
+  long wins = 0, draws = 0, turns = 0;
+
+  for (int64_t g = 0; g < store.NumGames(); ++g) {
+    const int64_t first = store.game_first_turn[g];
+    const int n = store.game_num_turns[g];
+    const int winner = store.game_winner[g];
+    MapStats& m = maps[store.game_map[g]];
+    m.games++;
+    m.turns += n;
+    wins += winner == 1;
+    draws += winner == 0;
+    m.wins += winner == 1;
+    m.draws += winner == 0;
+    turns += n;
+    if (n > 0) {
+      m.final_diff += store.turn_ships1[first + n - 1] -
+                      store.turn_ships2[first + n - 1];
+    }
+    if ((int)diff_sum.size() < n) {
+      diff_sum.resize(n, 0);
+      diff_games.resize(n, 0);
+    }
+    for (int t = 0; t < n; ++t) {
+      diff_sum[t] +=
+          store.turn_ships1[first + t] - store.turn_ships2[first + t];
+      diff_games[t]++;
+    }
+  }
+
+  const long games = store.NumGames();
+  printf("games games=%ld turns=%ld wins=%ld draws=%ld losses=%ld "
+         "win_rate=%.3f\n", games, turns, wins, draws, games - wins - draws,
+         games ? (wins + 0.5 * draws) / games : 0.0);
+  ReportTimes("1", store.turn_ms1, store);
+  ReportTimes("2", store.turn_ms2, store);
+  for (size_t t = 0; t < diff_sum.size(); t += options.step) {
+    printf("diff turn=%zu games=%ld mean=%.1f\n", t, diff_games[t],
+           diff_sum[t] / diff_games[t]);
+  }
+  for (size_t i = 0; i < maps.size(); ++i) {
+    const MapStats& m = maps[i];
+    if (m.games == 0)
+      continue;
+    printf("map name=%s games=%ld win_rate=%.3f draws=%ld mean_turns=%.1f "
+           "mean_final_diff=%.1f\n", store.MapName(i).c_str(), m.games,
+           (m.wins + 0.5 * m.draws) / m.games, m.draws,
+           (double)m.turns / m.games, (double)m.final_diff / m.games);
+  }
+  printf("report ms=%.1f\n", timer.ElapsedMs());
+  return 0;
+}
+
+bool ParseOption(const std::string& arg, Options& options) {
+  std::string::size_type eq = arg.find('=');
+  if (eq == std::string::npos) {
+    if (options.command.empty())
+      options.command = arg;
+    else
+      options.files.push_back(arg);
+    return true;
+  }
+  const std::string name = arg.substr(0, eq);
+  const std::string value = arg.substr(eq + 1);
+  if (name == "store")
+    options.store = value;
+  else if (name == "step")
+    options.step = std::max(1, atoi(value.c_str()));
+  else
+    return false;
+  return true;
+}
+
+}  // namespace
+
+int main(int argc, char *argv[]) {
+  Options options;
+  for (int i = 1; i < argc; ++i) {
+    if (!ParseOption(argv[i], options)) {
+      std::cerr << "Unknown option: " << argv[i] << std::endl;
+      return 1;
+    }
+  }
+  if (options.command == "ingest")
+    return Ingest(options);
+  if (options.command == "report")
+    return Report(options);
+  std::cerr << "Usage: gamelog ingest|report store=DIR [files]" << std::endl;
+  return 1;
+}
@@ -0,0 +1,206 @@
+#include "Generator.h"
+
+#include "../SpatialIndex.h"
+#include "../Zobrist.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <sstream>
+
+namespace {
+
+// splitmix64. std::mt19937 would do, but the standard distributions are
+// allowed to differ between libraries.
+class Random {
+ public:
+  explicit Random(uint64_t seed) : state_(seed) {}
+
+  uint64_t Next() {
+    state_ += 0x9e3779b97f4a7c15ULL;
+    return Zobrist::Mix(state_);
+  }
+
+  // Uniform in [low, high].
+  int Int(int low, int high) {
+    return low + (int)(Next() % (uint64_t)(high - low + 1));
+  }
+
+  // Uniform in [0, 1).
+  double Real() { return (Next() >> 11) * (1.0 / 9007199254740992.0); }
+
+ private:
+  uint64_t state_;
+};
+
+// Positions are kept to six decimals so they survive ToString() and
+// Parse() unchanged.
+double Round(double v) {
+  return floor(v * 1e6 + 0.5) / 1e6;
+}
+
+int Turns(const GeneratedPlanet& a, const GeneratedPlanet& b) {
+  const double dx = a.x - b.x;
+  const double dy = a.y - b.y;
+  return (int)ceil(sqrt(dx * dx + dy * dy));
+}
+
+}  // namespace
+
+bool GeneratorOptions::Set(const std::string& assignment) {
+  std::string::size_type eq = assignment.find('=');
+  if (eq == std::string::npos)
+    return false;
+  const std::string name = assignment.substr(0, eq);
+  const char *value = assignment.c_str() + eq + 1;
+  if (name == "planets")
+    planets = std::max(1, atoi(value));
+  else if (name == "fleets")
+    fleets = std::max(0, atoi(value));
+  else if (name == "players")
+    players = std::max(1, atoi(value));
+  else if (name == "owned")
+    owned_percent = std::min(100, std::max(0, atoi(value)));
+  else if (name == "max_trip")
+    max_trip = std::max(1, atoi(value));
+  else if (name == "seed")
+    seed = strtoull(value, 0, 10);
+  else
+    return false;
+  return true;
+}
+
+std::string GeneratedState::ToString() const {
+  std::string s;
+  char line[160];
+  for (size_t i = 0; i < planets.size(); ++i) {
+    const GeneratedPlanet& p = planets[i];
+    snprintf(line, sizeof(line), "P %.6f %.6f %d %d %d\n", p.x, p.y, p.owner,
+             p.num_ships, p.growth_rate);
+    s += line;
+  }
+  for (size_t i = 0; i < fleets.size(); ++i) {
+    const GeneratedFleet& f = fleets[i];
+    snprintf(line, sizeof(line), "F %d %d %d %d %d %d\n", f.owner,
+             f.num_ships, f.source_planet, f.destination_planet,
+             f.total_trip_length, f.turns_remaining);
+    s += line;
+  }
+  return s;
+}
+
+bool GeneratedState::Parse(const std::string& text) {
+  planets.clear();
+  fleets.clear();
+  std::istringstream in(text);
+  std::string line;
+  while (std::getline(in, line)) {
+    line = line.substr(0, line.find('#'));
+    std::istringstream fields(line);
+    std::string kind;
+    if (!(fields >> kind) || kind == "go")
+      continue;
+    if (kind == "P") {
+      GeneratedPlanet p;
+      if (!(fields >> p.x >> p.y >> p.owner >> p.num_ships >> p.growth_rate))
+        return false;
+      planets.push_back(p);
+    } else if (kind == "F") {
+      GeneratedFleet f;
+      if (!(fields >> f.owner >> f.num_ships >> f.source_planet >>
+            f.destination_planet >> f.total_trip_length >> f.turns_remaining))
+        return false;
+      fleets.push_back(f);
+    } else {
+      return false;
+    }
+  }
+  return true;
+}
+
+void GenerateState(const GeneratorOptions& options, GeneratedState *state) {
+  Random random(options.seed);
+  state->planets.clear();
+  state->fleets.clear();
+
+  // The bundled maps hold 23 planets in about 25 by 25.
+  const double side = 25 * sqrt(options.planets / 23.0);
+  for (int i = 0; i < options.planets; ++i) {
+    GeneratedPlanet p;
+    p.x = Round(random.Real() * side);
+    p.y = Round(random.Real() * side);
+    p.owner = 0;
+    p.growth_rate = random.Int(0, 5);
+    p.num_ships = random.Int(1, 20 * (p.growth_rate + 1));
+    state->planets.push_back(p);
+  }
+
+  // Homes spaced evenly on a circle around the middle.
+  std::vector<GeneratedPlanet> homes(options.players);
+  const double turn = random.Real() * 2 * M_PI;
+  for (int k = 0; k < options.players; ++k) {
+    const double angle = turn + 2 * M_PI * k / options.players;
+    homes[k].x = side / 2 + 0.35 * side * cos(angle);
+    homes[k].y = side / 2 + 0.35 * side * sin(angle);
+  }
+
+  // The planets nearest to any home are owned, each by the nearest player.
+  std::vector<std::pair<double, int> > order;
+  std::vector<int> nearest_home(options.planets);
+  for (int i = 0; i < options.planets; ++i) {
+    const GeneratedPlanet& p = state->planets[i];
+    double best = 0;
+    for (int k = 0; k < options.players; ++k) {
+      const double dx = p.x - homes[k].x, dy = p.y - homes[k].y;
+      const double d = dx * dx + dy * dy;
+      if (k == 0 || d < best) {
+        best = d;
+        nearest_home[i] = k;
+      }
+    }
+    order.push_back(std::make_pair(best, i));
+  }
+  std::sort(order.begin(), order.end());
+  const int owned = (long)options.planets * options.owned_percent / 100;
+  std::vector<int> sources;
+  for (int j = 0; j < owned; ++j) {
+    const int i = order[j].second;
+    GeneratedPlanet& p = state->planets[i];
+    p.owner = nearest_home[i] + 1;
+    p.num_ships = random.Int(0, 100 + 10 * p.growth_rate);
+    sources.push_back(i);
+  }
+  std::sort(sources.begin(), sources.end());
+  if (sources.empty())
+    return;
+
+  // Fleets on their way from an owned planet to one within max_trip.
+  std::vector<double> positions;
+  for (int i = 0; i < options.planets; ++i) {
+    positions.push_back(state->planets[i].x);
+    positions.push_back(state->planets[i].y);
+  }
+  SpatialIndex index;
+  index.Build(positions);
+  std::vector<int> targets;
+  // Gives up on maps where no planet has a neighbor within max_trip.
+  long attempts = 100L * options.fleets + 1000;
+  while ((int)state->fleets.size() < options.fleets && attempts-- > 0) {
+    const int source = sources[random.Int(0, sources.size() - 1)];
+    const GeneratedPlanet& s = state->planets[source];
+    index.Within(s.x, s.y, options.max_trip, SpatialIndex::kAnyOwner,
+                 &targets);
+    const int destination = targets[random.Int(0, targets.size() - 1)];
+    if (destination == source)
+      continue;
+    GeneratedFleet f;
+    f.owner = s.owner;
+    f.num_ships = random.Int(1, 60);
+    f.source_planet = source;
+    f.destination_planet = destination;
+    f.total_trip_length = std::max(1, Turns(s, state->planets[destination]));
+    f.turns_remaining = random.Int(1, f.total_trip_length);
+    state->fleets.push_back(f);
+  }
+}
@@ -0,0 +1,75 @@
+// Random maps and mid-game states for the benchmarks, in the format the
+// engine sends to bots ("P x y owner ships growth" and
+// "F owner ships source destination trip remaining" lines).
+//
+// Planets are spread evenly over a square as densely as on the bundled
+// maps. Each player owns the planets nearest to its home, which are spaced
+// around the middle of the map, and every fleet flies from a planet of its
+// owner to a planet a few turns away. Every number is drawn from a
+// splitmix64 stream started from the seed rather than from the standard
+// library's distributions, so the same options give the same state
+// whichever library the tools are built with.
+#ifndef TOOLS_GENERATOR_H_
+#define TOOLS_GENERATOR_H_
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+struct GeneratorOptions {
+  int planets;
+  int fleets;
+  int players;
+  // Share of the planets the players own between them, in percent.
+  int owned_percent;
+  // Longest trip a fleet is sent on, in turns.
+  int max_trip;
+  uint64_t seed;
+
+  GeneratorOptions()
+      : planets(1000),
+        fleets(10000),
+        players(2),
+        owned_percent(40),
+        max_trip(25),
+        seed(1) {
+  }
+
+  // Sets one option from a "name=value" string. Returns false if the name
+  // is unknown.
+  bool Set(const std::string& assignment);
+};
+
+struct GeneratedPlanet {
+  double x, y;
+  int owner;
+  int num_ships;
+  int growth_rate;
+};
+
+struct GeneratedFleet {
+  int owner;
+  int num_ships;
+  int source_planet;
+  int destination_planet;
+  int total_trip_length;
+  int turns_remaining;
+};
+
+// A state as plain data. Unlike PlanetWars it puts no limit on the number
+// of planets and builds no per-map tables.
+struct GeneratedState {
+  std::vector<GeneratedPlanet> planets;
+  std::vector<GeneratedFleet> fleets;
+
+  // The state as P and F lines, without the closing "go".
+  std::string ToString() const;
+
+  // Reads P and F lines, ignoring "go" and comments. Returns false on a
+  // malformed line.
+  bool Parse(const std::string& text);
+};
+
+void GenerateState(const GeneratorOptions& options, GeneratedState *state);
+
+#endif
@@ -0,0 +1,226 @@
+#include "LogStore.h"
+
+#include <algorithm>
+#include <fcntl.h>
+#include <fstream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+// In the order of LogWriter::ColumnId.
+const char *const kColumnFiles[] = {
+  "games.map", "games.source", "games.winner", "games.first_turn",
+  "games.num_turns",
+  "turns.game", "turns.turn", "turns.ships1", "turns.ships2",
+  "turns.planets1", "turns.planets2", "turns.growth1", "turns.growth2",
+  "turns.fleets", "turns.orders1", "turns.orders2", "turns.ms1", "turns.ms2",
+  "turns.first_planet", "turns.first_fleet",
+  "planets.owner", "planets.ships",
+  "fleets.owner", "fleets.ships", "fleets.source", "fleets.destination",
+  "fleets.trip", "fleets.remaining"
+};
+
+int64_t FileSize(const std::string& path) {
+  struct stat st;
+  return stat(path.c_str(), &st) == 0 ? st.st_size : 0;
+}
+
+std::vector<std::string> ReadMaps(const std::string& dir) {
+  std::vector<std::string> maps;
+  std::ifstream in((dir + "/maps.txt").c_str());
+  std::string line;
+  while (std::getline(in, line))
+    maps.push_back(line);
+  return maps;
+}
+
+}  // namespace
+
+LogWriter::LogWriter()
+    : num_games_(0),
+      num_turns_(0),
+      num_planets_(0),
+      num_fleets_(0),
+      ok_(true) {
+  std::fill(files_, files_ + kNumColumns, (FILE *)0);
+}
+
+LogWriter::~LogWriter() {
+  Close();
+}
+
+bool LogWriter::Open(const std::string& dir) {
+  Close();
+  mkdir(dir.c_str(), 0777);
+  struct stat st;
+  if (stat(dir.c_str(), &st) != 0 || !S_ISDIR(st.st_mode))
+    return false;
+  dir_ = dir;
+  maps_ = ReadMaps(dir);
+  // New rows go after whatever is there, even rows no game refers to.
+  num_games_ = FileSize(dir + "/games.winner");
+  num_turns_ = FileSize(dir + "/turns.game") / sizeof(int32_t);
+  num_planets_ = FileSize(dir + "/planets.owner");
+  num_fleets_ = FileSize(dir + "/fleets.owner");
+  ok_ = true;
+  for (int c = 0; c < kNumColumns; ++c) {
+    files_[c] = fopen((dir + "/" + kColumnFiles[c]).c_str(), "ab");
+    if (!files_[c]) {
+      Close();
+      return false;
+    }
+  }
+  return true;
+}
+
+template <class T>
+void LogWriter::Put(ColumnId column, T value) {
+  if (fwrite(&value, sizeof(value), 1, files_[column]) != 1)
+    ok_ = false;
+}
+
+void LogWriter::AddGame(const std::string& map, LogSource source,
+                        const std::vector<TurnSnapshot>& turns, int winner) {
+  int map_id = std::find(maps_.begin(), maps_.end(), map) - maps_.begin();
+  if (map_id == (int)maps_.size()) {
+    maps_.push_back(map);
+    std::ofstream out((dir_ + "/maps.txt").c_str(), std::ios::app);
+    out << map << "\n";
+    ok_ = ok_ && out;
+  }
+
+  const int64_t first_turn = num_turns_;
+  for (size_t t = 0; t < turns.size(); ++t) {
+    const TurnSnapshot& turn = turns[t];
+    int ships[3] = { 0, 0, 0 }, planets[3] = { 0, 0, 0 };
+    int growth[3] = { 0, 0, 0 };
+    Put<int64_t>(kTurnFirstPlanet, num_planets_);
+    Put<int64_t>(kTurnFirstFleet, num_fleets_);
+    for (size_t i = 0; i < turn.planets.size(); ++i) {
+      const SnapshotPlanet& p = turn.planets[i];
+      if (p.owner == 1 || p.owner == 2) {
+        ships[p.owner] += p.num_ships;
+        planets[p.owner]++;
+        growth[p.owner] += p.growth_rate;
+      }
+      Put<uint8_t>(kPlanetOwner, p.owner);
+      Put<int32_t>(kPlanetShips, p.num_ships);
+    }
+    for (size_t i = 0; i < turn.fleets.size(); ++i) {
+      const SnapshotFleet& f = turn.fleets[i];
+      if (f.owner == 1 || f.owner == 2)
+        ships[f.owner] += f.num_ships;
+      Put<uint8_t>(kFleetOwner, f.owner);
+      Put<int32_t>(kFleetShips, f.num_ships);
+      Put<uint16_t>(kFleetSource, f.source_planet);
+      Put<uint16_t>(kFleetDestination, f.destination_planet);
+      Put<uint16_t>(kFleetTrip, f.total_trip_length);
+      Put<uint16_t>(kFleetRemaining, f.turns_remaining);
+    }
+    num_planets_ += turn.planets.size();
+    num_fleets_ += turn.fleets.size();
+
+    Put<int32_t>(kTurnGame, num_games_);
+    Put<int16_t>(kTurnTurn, t);
+    Put<int32_t>(kTurnShips1, ships[1]);
+    Put<int32_t>(kTurnShips2, ships[2]);
+    Put<int16_t>(kTurnPlanets1, planets[1]);
+    Put<int16_t>(kTurnPlanets2, planets[2]);
+    Put<int16_t>(kTurnGrowth1, growth[1]);
+    Put<int16_t>(kTurnGrowth2, growth[2]);
+    Put<int32_t>(kTurnFleets, turn.fleets.size());
+    Put<int16_t>(kTurnOrders1, turn.orders[0]);
+    Put<int16_t>(kTurnOrders2, turn.orders[1]);
+    Put<float>(kTurnMs1, turn.turn_ms[0]);
+    Put<float>(kTurnMs2, turn.turn_ms[1]);
+  }
+  num_turns_ += turns.size();
+
+  Put<int32_t>(kGameMap, map_id);
+  Put<int8_t>(kGameSource, source);
+  Put<int64_t>(kGameFirstTurn, first_turn);
+  Put<int32_t>(kGameNumTurns, turns.size());
+  Put<int8_t>(kGameWinner, winner);
+  ++num_games_;
+}
+
+bool LogWriter::Close() {
+  for (int c = 0; c < kNumColumns; ++c) {
+    if (files_[c] && fclose(files_[c]) != 0)
+      ok_ = false;
+    files_[c] = 0;
+  }
+  const bool ok = ok_;
+  ok_ = true;
+  return ok;
+}
+
+template <class T>
+bool Column<T>::Map(const std::string& path) {
+  Unmap();
+  const int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0)
+    return false;
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    close(fd);
+    return false;
+  }
+  bytes_ = st.st_size;
+  size_ = bytes_ / sizeof(T);
+  if (bytes_ > 0) {
+    void *data = mmap(0, bytes_, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data == MAP_FAILED) {
+      close(fd);
+      size_ = bytes_ = 0;
+      return false;
+    }
+    data_ = static_cast<const T *>(data);
+  }
+  close(fd);
+  return true;
+}
+
+template <class T>
+void Column<T>::Unmap() {
+  if (data_)
+    munmap(const_cast<T *>(data_), bytes_);
+  data_ = 0;
+  size_ = bytes_ = 0;
+}
+
+template class Column<int8_t>;
+template class Column<int32_t>;
+template class Column<int64_t>;
+template class Column<float>;
+
+bool LogReader::Open(const std::string& dir) {
+  maps_ = ReadMaps(dir);
+  const std::string p = dir + "/";
+  if (!(game_map.Map(p + "games.map") &&
+        game_source.Map(p + "games.source") &&
+        game_winner.Map(p + "games.winner") &&
+        game_first_turn.Map(p + "games.first_turn") &&
+        game_num_turns.Map(p + "games.num_turns") &&
+        turn_ships1.Map(p + "turns.ships1") &&
+        turn_ships2.Map(p + "turns.ships2") &&
+        turn_ms1.Map(p + "turns.ms1") &&
+        turn_ms2.Map(p + "turns.ms2")))
+    return false;
+
+  // Drops games cut short by an interrupted ingest.
+  num_games_ = std::min(std::min(game_map.size(), game_source.size()),
+                        std::min(game_winner.size(), game_first_turn.size()));
+  num_games_ = std::min<int64_t>(num_games_, game_num_turns.size());
+  const size_t turns = std::min(std::min(turn_ships1.size(),
+                                         turn_ships2.size()),
+                                std::min(turn_ms1.size(), turn_ms2.size()));
+  while (num_games_ > 0 &&
+         (game_first_turn[num_games_ - 1] +
+              game_num_turns[num_games_ - 1] > (int64_t)turns ||
+          game_map[num_games_ - 1] >= (int)maps_.size()))
+    --num_games_;
+  return true;
+}
@@ -0,0 +1,154 @@
+// A column store of played games for tools/GameLog.cc.
+//
+// A store is a directory holding one flat file per column. A row is one
+// fixed-width little-endian value. Ingesting appends to every column, and
+// a query maps just the columns it reads. The tables:
+//
+//   games    map, source, winner, first_turn, num_turns
+//   turns    game, turn, ships1, ships2, planets1, planets2, growth1,
+//            growth2, fleets, orders1, orders2, ms1, ms2,
+//            first_planet, first_fleet
+//   planets  owner, ships              (every planet, every turn)
+//   fleets   owner, ships, source, destination, trip, remaining
+//
+// Players 1 and 2 get their own columns in turns, since every query looks
+// at one of them at a time. A turn's planets and fleets are the rows
+// starting at first_planet and first_fleet. Unknown turn times and order
+// counts are stored as -1. Map names live in maps.txt, one per line, and
+// games.map is a line number in it.
+#ifndef TOOLS_LOG_STORE_H_
+#define TOOLS_LOG_STORE_H_
+
+#include <cstdio>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+// Where a game was ingested from.
+enum LogSource {
+  kVisOutput = 0,
+  kEngineLog = 1,
+  kNativeLog = 2
+};
+
+struct SnapshotPlanet {
+  int owner;
+  int num_ships;
+  int growth_rate;
+};
+
+struct SnapshotFleet {
+  int owner;
+  int num_ships;
+  int source_planet;
+  int destination_planet;
+  int total_trip_length;
+  int turns_remaining;
+};
+
+// One turn of a game as the ingester reads it.
+struct TurnSnapshot {
+  std::vector<SnapshotPlanet> planets;
+  std::vector<SnapshotFleet> fleets;
+  // Per player 1 and 2; -1 when the log does not say.
+  int orders[2];
+  float turn_ms[2];
+
+  TurnSnapshot() {
+    orders[0] = orders[1] = -1;
+    turn_ms[0] = turn_ms[1] = -1;
+  }
+};
+
+// Appends games to a store, creating it if needed.
+class LogWriter {
+ public:
+  LogWriter();
+  ~LogWriter();
+
+  bool Open(const std::string& dir);
+
+  // Adds one game. winner is 1 or 2, or 0 for a draw.
+  void AddGame(const std::string& map, LogSource source,
+               const std::vector<TurnSnapshot>& turns, int winner);
+
+  // Flushes every column. Returns false if a write failed.
+  bool Close();
+
+ private:
+  enum ColumnId {
+    kGameMap, kGameSource, kGameWinner, kGameFirstTurn, kGameNumTurns,
+    kTurnGame, kTurnTurn, kTurnShips1, kTurnShips2, kTurnPlanets1,
+    kTurnPlanets2, kTurnGrowth1, kTurnGrowth2, kTurnFleets, kTurnOrders1,
+    kTurnOrders2, kTurnMs1, kTurnMs2, kTurnFirstPlanet, kTurnFirstFleet,
+    kPlanetOwner, kPlanetShips,
+    kFleetOwner, kFleetShips, kFleetSource, kFleetDestination, kFleetTrip,
+    kFleetRemaining,
+    kNumColumns
+  };
+
+  template <class T>
+  void Put(ColumnId column, T value);
+
+  std::string dir_;
+  std::vector<std::string> maps_;
+  FILE *files_[kNumColumns];
+  int64_t num_games_;
+  int64_t num_turns_;
+  int64_t num_planets_;
+  int64_t num_fleets_;
+  bool ok_;
+};
+
+// A column mapped read-only.
+template <class T>
+class Column {
+ public:
+  Column() : data_(0), size_(0), bytes_(0) {}
+  ~Column() { Unmap(); }
+
+  bool Map(const std::string& path);
+  void Unmap();
+
+  size_t size() const { return size_; }
+  T operator[](size_t i) const { return data_[i]; }
+
+ private:
+  const T *data_;
+  size_t size_;
+  size_t bytes_;
+
+  Column(const Column&);
+  void operator=(const Column&);
+};
+
+// The columns of games and turns that the reports read. Snapshots of
+// planets and fleets are left unmapped.
+class LogReader {
+ public:
+  LogReader() : num_games_(0) {}
+
+  bool Open(const std::string& dir);
+
+  // Games whose rows are all present.
+  int64_t NumGames() const { return num_games_; }
+  const std::string& MapName(int map) const { return maps_[map]; }
+  int NumMaps() const { return maps_.size(); }
+
+  Column<int32_t> game_map;
+  Column<int8_t> game_source;
+  Column<int8_t> game_winner;
+  Column<int64_t> game_first_turn;
+  Column<int32_t> game_num_turns;
+
+  Column<int32_t> turn_ships1;
+  Column<int32_t> turn_ships2;
+  Column<float> turn_ms1;
+  Column<float> turn_ms2;
+
+ private:
+  std::vector<std::string> maps_;
+  int64_t num_games_;
+};
+
+#endif
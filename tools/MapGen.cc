@@ -0,0 +1,31 @@
+// Writes a random mid-game state for the benchmarks to standard output.
+//
+//   make mapgen
+//   ./mapgen planets=5000 fleets=40000 players=4 seed=7 > big.txt
+//   ./benchmark spatial parse fleets turn state=big.txt
+//
+// Options are name=value pairs, see GeneratorOptions in Generator.h: planets,
+// fleets, players, owned (percent of planets owned), max_trip and seed. The
+// output has no closing "go"; the turn suite adds it and times the bot's
+// turn, or by hand: (cat big.txt; echo go) | ./MyBot. The state above takes
+// the bot a fraction of a second.
+
+#include "Generator.h"
+
+#include <cstdio>
+#include <iostream>
+
+int main(int argc, char *argv[]) {
+  GeneratorOptions options;
+  for (int i = 1; i < argc; ++i) {
+    if (!options.Set(argv[i])) {
+      std::cerr << "Unknown option: " << argv[i] << std::endl;
+      return 1;
+    }
+  }
+  GeneratedState state;
+  GenerateState(options, &state);
+  const std::string text = state.ToString();
+  fwrite(text.data(), 1, text.size(), stdout);
+  return 0;
+}
@@ -0,0 +1,307 @@
+// Builds the opening book (see OpeningBook.h) for the maps in maps/.
+//
+//   make openings
+//   ./openings bot=./galcon turns=8 out=opening.book select_ms=900
+//   ./openings maps=1-10 turns=1
+//
+// For every map the bot plays itself for the first turns, one process per
+// seat, with the given name=value parameters (by default a larger selection
+// budget than a turn allows, which on the maps it was checked on still
+// gives the orders of live play; see OpeningBook.h). Each position a seat is shown is
+// stored with the orders it gave, keyed by the map's layout hash and the
+// position's hash as that seat sees it. Games are spread over all cores.
+
+#include "../GameState.h"
+#include "../OpeningBook.h"
+#include "../PlanetWars.h"
+
+#include <algorithm>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+struct Options {
+  std::string bot;
+  std::string out;
+  std::vector<std::string> bot_args;
+  int turns;
+  int threads;
+  int first_map;
+  int last_map;
+
+  Options()
+      : bot("./galcon"),
+        out("opening.book"),
+        turns(8),
+        threads(std::max(1u, std::thread::hardware_concurrency())),
+        first_map(1),
+        last_map(100) {
+    bot_args.push_back("select_nodes=1000000");
+    bot_args.push_back("select_ms=900");
+  }
+};
+
+// A bot running in a child process, talked to over pipes.
+class BotProcess {
+ public:
+  BotProcess() : pid_(-1), in_(0), out_(0) {}
+  ~BotProcess() { Stop(); }
+
+  bool Start(const std::string& command) {
+    int to_bot[2], from_bot[2];
+    if (pipe(to_bot) != 0)
+      return false;
+    if (pipe(from_bot) != 0) {
+      close(to_bot[0]);
+      close(to_bot[1]);
+      return false;
+    }
+    pid_ = fork();
+    if (pid_ == 0) {
+      dup2(to_bot[0], STDIN_FILENO);
+      dup2(from_bot[1], STDOUT_FILENO);
+      close(to_bot[0]);
+      close(to_bot[1]);
+      close(from_bot[0]);
+      close(from_bot[1]);
+      execl("/bin/sh", "sh", "-c", ("exec " + command).c_str(), (char *)0);
+      _exit(127);
+    }
+    close(to_bot[0]);
+    close(from_bot[1]);
+    in_ = fdopen(to_bot[1], "w");
+    out_ = fdopen(from_bot[0], "r");
+    return pid_ > 0 && in_ && out_;
+  }
+
+  // Sends a state and reads the orders up to the bot's "go". Returns false
+  // if the bot died or sent something that is not an order.
+  bool Turn(const std::string& state,
+            std::vector<OpeningBook::Order> *orders) {
+    orders->clear();
+    if (fputs(state.c_str(), in_) < 0 || fputs("go\n", in_) < 0 ||
+        fflush(in_) != 0)
+      return false;
+    char line[256];
+    while (fgets(line, sizeof(line), out_)) {
+      if (strncmp(line, "go", 2) == 0)
+        return true;
+      int source, destination, ships;
+      if (sscanf(line, "%d %d %d", &source, &destination, &ships) != 3)
+        return false;
+      // The book keeps 16 bits of each; anything else would wrap and might
+      // pass Valid().
+      if (source < 0 || source > 0xffff || destination < 0 ||
+          destination > 0xffff || ships < 0 || ships > 0xffff)
+        return false;
+      OpeningBook::Order order = { (uint16_t)source, (uint16_t)destination,
+                                   (uint16_t)ships };
+      orders->push_back(order);
+    }
+    return false;
+  }
+
+  void Stop() {
+    if (in_)
+      fclose(in_);
+    if (out_)
+      fclose(out_);
+    if (pid_ > 0) {
+      kill(pid_, SIGTERM);
+      waitpid(pid_, 0, 0);
+    }
+    pid_ = -1;
+    in_ = out_ = 0;
+  }
+
+ private:
+  pid_t pid_;
+  FILE *in_;
+  FILE *out_;
+};
+
+// The state as player seat sees it: the engine swaps players 1 and 2 for
+// the second seat.
+std::string View(const MapGeometry& map, const GameState& state, int seat) {
+  std::string s;
+  char line[128];
+  for (int i = 0; i < state.NumPlanets(); ++i) {
+    const PlanetState& p = state.GetPlanet(i);
+    const int owner = seat == 2 && p.owner != 0 ? 3 - p.owner : p.owner;
+    snprintf(line, sizeof(line), "P %.17g %.17g %d %d %d\n", map.X(i),
+             map.Y(i), owner, p.num_ships, map.GrowthRate(i));
+    s += line;
+  }
+  for (int i = 0; i < state.NumFleets(); ++i) {
+    const FleetState& f = state.GetFleet(i);
+    const int owner = seat == 2 ? 3 - f.owner : f.owner;
+    snprintf(line, sizeof(line), "F %d %d %d %d %d %d\n", owner, f.num_ships,
+             f.source_planet, f.destination_planet, f.total_trip_length,
+             f.turns_remaining);
+    s += line;
+  }
+  return s;
+}
+
+// Returns true if the orders can be carried out by player 1 in pw.
+bool Valid(const PlanetWars& pw,
+           const std::vector<OpeningBook::Order>& orders) {
+  std::vector<int> ships(pw.NumPlanets());
+  for (int i = 0; i < pw.NumPlanets(); ++i)
+    ships[i] = pw.GetPlanet(i).Owner() == 1 ? pw.GetPlanet(i).NumShips() : 0;
+  for (size_t i = 0; i < orders.size(); ++i) {
+    const OpeningBook::Order& o = orders[i];
+    if (o.source_planet >= pw.NumPlanets() ||
+        o.destination_planet >= pw.NumPlanets() ||
+        o.source_planet == o.destination_planet || o.num_ships == 0 ||
+        o.num_ships > ships[o.source_planet])
+      return false;
+    ships[o.source_planet] -= o.num_ships;
+  }
+  return true;
+}
+
+bool Alive(const GameState& state, int player) {
+  for (int i = 0; i < state.NumPlanets(); ++i) {
+    if (state.GetPlanet(i).owner == player)
+      return true;
+  }
+  for (int i = 0; i < state.NumFleets(); ++i) {
+    if (state.GetFleet(i).owner == player)
+      return true;
+  }
+  return false;
+}
+
+// Plays the opening of one map and adds the positions to positions.
+// Returns the number of positions added.
+int PlayOpening(const std::string& map_file, const Options& options,
+                OpeningBook::Positions *positions, std::mutex *lock) {
+  std::ifstream in(map_file.c_str());
+  if (!in)
+    return 0;
+  std::stringstream text;
+  text << in.rdbuf();
+  const PlanetWars start(text.str());
+  const MapGeometry map(start);
+  GameState game(start);
+
+  std::string command = options.bot + " book=";
+  for (size_t i = 0; i < options.bot_args.size(); ++i)
+    command += " " + options.bot_args[i];
+  BotProcess bots[2];
+  if (!bots[0].Start(command) || !bots[1].Start(command)) {
+    std::cerr << "Cannot start " << options.bot << std::endl;
+    return 0;
+  }
+
+  OpeningBook::Positions found;
+  std::vector<OpeningBook::Order> orders[2];
+  for (int turn = 0; turn < options.turns; ++turn) {
+    if (!Alive(game, 1) || !Alive(game, 2))
+      break;
+    for (int seat = 1; seat <= 2; ++seat) {
+      const std::string view = View(map, game, seat);
+      // Parsed exactly as the bot parses it, so the hash is the one it will
+      // look up.
+      const PlanetWars pw(view);
+      if (!bots[seat - 1].Turn(view, &orders[seat - 1]) ||
+          !Valid(pw, orders[seat - 1])) {
+        std::cerr << map_file << ": bad orders from seat " << seat
+                  << " on turn " << turn << std::endl;
+        return 0;
+      }
+      found[std::make_pair(map.LayoutHash(), GameState(pw).Hash())] =
+          orders[seat - 1];
+    }
+    for (int seat = 0; seat < 2; ++seat) {
+      for (size_t i = 0; i < orders[seat].size(); ++i) {
+        const OpeningBook::Order& o = orders[seat][i];
+        game.IssueOrder(map, o.source_planet, o.destination_planet,
+                        o.num_ships);
+      }
+    }
+    game.AdvanceTurn(map);
+  }
+
+  std::lock_guard<std::mutex> guard(*lock);
+  positions->insert(found.begin(), found.end());
+  return found.size();
+}
+
+bool ParseOption(const std::string& arg, Options& options) {
+  std::string::size_type eq = arg.find('=');
+  if (eq == std::string::npos)
+    return false;
+  const std::string name = arg.substr(0, eq);
+  const std::string value = arg.substr(eq + 1);
+  if (name == "bot")
+    options.bot = value;
+  else if (name == "out")
+    options.out = value;
+  else if (name == "turns")
+    options.turns = std::max(1, atoi(value.c_str()));
+  else if (name == "threads")
+    options.threads = std::max(1, atoi(value.c_str()));
+  else if (name == "maps")
+    sscanf(value.c_str(), "%d-%d", &options.first_map, &options.last_map);
+  else
+    options.bot_args.push_back(arg);
+  return true;
+}
+
+}  // namespace
+
+int main(int argc, char *argv[]) {
+  Options options;
+  for (int i = 1; i < argc; ++i) {
+    if (!ParseOption(argv[i], options)) {
+      std::cerr << "Unknown option: " << argv[i] << std::endl;
+      return 1;
+    }
+  }
+  signal(SIGPIPE, SIG_IGN);
+
+  OpeningBook::Positions positions;
+  std::mutex lock;
+  int next_map = options.first_map;
+  std::vector<std::thread> workers;
+  for (int t = 0; t < options.threads; ++t) {
+    workers.push_back(std::thread([&]() {
+      while (true) {
+        int map;
+        {
+          std::lock_guard<std::mutex> guard(lock);
+          if (next_map > options.last_map)
+            return;
+          map = next_map++;
+        }
+        std::stringstream name;
+        name << "maps/map" << map << ".txt";
+        PlayOpening(name.str(), options, &positions, &lock);
+      }
+    }));
+  }
+  for (size_t t = 0; t < workers.size(); ++t)
+    workers[t].join();
+
+  if (!OpeningBook::Write(options.out, positions)) {
+    std::cerr << "Cannot write " << options.out << std::endl;
+    return 1;
+  }
+  std::cout << "Wrote " << positions.size() << " positions to "
+            << options.out << std::endl;
+  return 0;
+}
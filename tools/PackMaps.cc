@@ -0,0 +1,47 @@
+// Compiles map files into one map pack (see MapPack.h).
+//
+//   make maps.pack
+//   ./packmaps out=maps.pack maps/*.txt
+//
+// Without any map files it packs maps/map1.txt to maps/map100.txt. The bot
+// and the tools look for maps.pack in the directory they run in.
+
+#include "../MapPack.h"
+
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+int main(int argc, char *argv[]) {
+  std::string out = "maps.pack";
+  std::vector<std::string> paths;
+  for (int i = 1; i < argc; ++i) {
+    if (strncmp(argv[i], "out=", 4) == 0)
+      out = argv[i] + 4;
+    else
+      paths.push_back(argv[i]);
+  }
+  if (paths.empty()) {
+    for (int m = 1; m <= 100; ++m) {
+      std::stringstream name;
+      name << "maps/map" << m << ".txt";
+      paths.push_back(name.str());
+    }
+  }
+
+  std::string error;
+  if (!MapPack::Write(out, paths, &error)) {
+    std::cerr << "packmaps: " << error << std::endl;
+    return 1;
+  }
+  MapPack pack;
+  if (!pack.Open(out)) {
+    std::cerr << "packmaps: cannot read back " << out << std::endl;
+    return 1;
+  }
+  printf("%s: %d maps\n", out.c_str(), pack.NumMaps());
+  return 0;
+}
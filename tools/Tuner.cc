@@ -0,0 +1,318 @@
+// Searches the planner parameters in Params.h by self-play.
+//
+// A small genetic algorithm keeps a population of parameter sets. Every
+// generation each set plays the same batch of games (a sample of the maps
+// in maps/ against each opponent), the games are spread over all cores, and
+// the best sets are carried over, crossed and mutated. At the end the best
+// sets seen are re-played on every map and printed with their score and a
+// 95% confidence interval.
+//
+//   make tuner
+//   ./tuner bot=./galcon opponent=example_bots/DualBot.jar generations=20
+//
+// Games are run with tools/PlayGame.jar, so java must be on the path. The
+// bot receives the candidate parameters as name=value arguments.
+
+#include "../Params.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+struct Options {
+  std::string bot;
+  std::vector<std::string> opponents;
+  int population;
+  int generations;
+  int maps_per_generation;
+  int elite;
+  int top;
+  int threads;
+  int max_turns;
+  int turn_time;
+  unsigned seed;
+
+  Options()
+      : bot("./galcon"),
+        population(16),
+        generations(10),
+        maps_per_generation(10),
+        elite(4),
+        top(5),
+        threads(std::max(1u, std::thread::hardware_concurrency())),
+        max_turns(200),
+        turn_time(1000),
+        seed(1) {
+  }
+};
+
+struct Candidate {
+  Params params;
+  int games;
+  double points;  // wins count 1, draws count 1/2
+
+  Candidate() : games(0), points(0) {}
+
+  double Score() const { return games > 0 ? points / games : 0; }
+};
+
+struct Game {
+  int candidate;
+  int map;
+  std::string opponent;
+};
+
+// Plays one game and returns our points: 1 for a win, 0.5 for a draw and 0
+// for a loss or a game that could not be run.
+double PlayGame(const Options& options, const Params& candidate,
+                int map, const std::string& opponent) {
+  Params params = candidate;
+  params.max_turns = options.max_turns;
+  std::stringstream cmd;
+  cmd << "java -jar tools/PlayGame.jar maps/map" << map << ".txt "
+      << options.turn_time << " " << options.max_turns << " /dev/null "
+      << "\"" << options.bot << " " << params.ToString() << "\" "
+      << "\"java -jar " << opponent << "\" 2>&1 >/dev/null";
+  FILE *f = popen(cmd.str().c_str(), "r");
+  if (!f)
+    return 0;
+  double result = 0;
+  char line[256];
+  while (fgets(line, sizeof(line), f)) {
+    std::string s(line);
+    if (s.find("Player 1 Wins!") != std::string::npos)
+      result = 1;
+    else if (s.find("Draw!") != std::string::npos)
+      result = 0.5;
+  }
+  pclose(f);
+  return result;
+}
+
+// Plays every game in the list on options.threads worker threads and adds
+// the results to the candidates.
+void PlayGames(const Options& options, const std::vector<Game>& games,
+               std::vector<Candidate>& candidates) {
+  std::mutex lock;
+  size_t next = 0;
+  std::vector<std::thread> workers;
+  for (int w = 0; w < options.threads; ++w) {
+    workers.push_back(std::thread([&]() {
+      while (true) {
+        size_t i;
+        {
+          std::lock_guard<std::mutex> guard(lock);
+          if (next == games.size())
+            return;
+          i = next++;
+        }
+        const Game& g = games[i];
+        double points = PlayGame(options, candidates[g.candidate].params,
+                                 g.map, g.opponent);
+        std::lock_guard<std::mutex> guard(lock);
+        candidates[g.candidate].games++;
+        candidates[g.candidate].points += points;
+      }
+    }));
+  }
+  for (size_t w = 0; w < workers.size(); ++w)
+    workers[w].join();
+}
+
+// Wilson score interval for a proportion at 95% confidence.
+void Confidence(const Candidate& c, double *low, double *high) {
+  const double z = 1.96;
+  double n = c.games;
+  if (n == 0) {
+    *low = 0;
+    *high = 1;
+    return;
+  }
+  double p = c.Score();
+  double center = (p + z * z / (2 * n)) / (1 + z * z / n);
+  double spread = z * sqrt(p * (1 - p) / n + z * z / (4 * n * n)) /
+                  (1 + z * z / n);
+  *low = std::max(0.0, center - spread);
+  *high = std::min(1.0, center + spread);
+}
+
+Params Mutate(const Params& parent, std::mt19937& rng) {
+  Params p = parent;
+  std::uniform_real_distribution<double> coin(0, 1);
+  for (int i = 0; i < kNumParams; ++i) {
+    const ParamInfo& info = kParamTable[i];
+    if (!info.tunable || coin(rng) > 0.3)
+      continue;
+    double sigma = std::max(1.0, (info.max - info.min) / 10.0);
+    std::normal_distribution<double> step(0, sigma);
+    int v = p.*info.field + (int)lround(step(rng));
+    p.*info.field = std::min(info.max, std::max(info.min, v));
+  }
+  return p;
+}
+
+Params Crossover(const Params& a, const Params& b, std::mt19937& rng) {
+  Params p = a;
+  std::uniform_int_distribution<int> coin(0, 1);
+  for (int i = 0; i < kNumParams; ++i) {
+    if (coin(rng))
+      p.*kParamTable[i].field = b.*kParamTable[i].field;
+  }
+  return p;
+}
+
+bool BetterCandidate(const Candidate& a, const Candidate& b) {
+  return a.Score() > b.Score();
+}
+
+void Print(const Candidate& c) {
+  double low, high;
+  Confidence(c, &low, &high);
+  printf("%.3f [%.3f, %.3f] games=%d  %s\n", c.Score(), low, high, c.games,
+         c.params.ToString().c_str());
+  fflush(stdout);
+}
+
+bool ParseOption(const std::string& arg, Options& options) {
+  std::string::size_type eq = arg.find('=');
+  if (eq == std::string::npos)
+    return false;
+  const std::string name = arg.substr(0, eq);
+  const std::string value = arg.substr(eq + 1);
+  if (name == "bot")
+    options.bot = value;
+  else if (name == "opponent")
+    options.opponents.push_back(value);
+  else if (name == "population")
+    options.population = atoi(value.c_str());
+  else if (name == "generations")
+    options.generations = atoi(value.c_str());
+  else if (name == "maps")
+    options.maps_per_generation = atoi(value.c_str());
+  else if (name == "elite")
+    options.elite = atoi(value.c_str());
+  else if (name == "top")
+    options.top = atoi(value.c_str());
+  else if (name == "threads")
+    options.threads = atoi(value.c_str());
+  else if (name == "turns")
+    options.max_turns = atoi(value.c_str());
+  else if (name == "turn_time")
+    options.turn_time = atoi(value.c_str());
+  else if (name == "seed")
+    options.seed = strtoul(value.c_str(), 0, 10);
+  else
+    return false;
+  return true;
+}
+
+}  // namespace
+
+int main(int argc, char *argv[]) {
+  Options options;
+  for (int i = 1; i < argc; ++i) {
+    if (!ParseOption(argv[i], options)) {
+      std::cerr << "Unknown option: " << argv[i] << std::endl;
+      return 1;
+    }
+  }
+  if (options.opponents.empty())
+    options.opponents.push_back("example_bots/DualBot.jar");
+  options.population = std::max(options.population, 2);
+  options.elite = std::min(std::max(options.elite, 1), options.population);
+  options.threads = std::max(options.threads, 1);
+
+  const int kNumMaps = 100;
+  std::mt19937 rng(options.seed);
+
+  // The hand tuned defaults are always part of the first generation.
+  std::vector<Candidate> population(options.population);
+  for (size_t i = 1; i < population.size(); ++i)
+    population[i].params = Mutate(population[0].params, rng);
+
+  std::vector<Candidate> best;
+  for (int gen = 0; gen < options.generations; ++gen) {
+    // Every candidate plays the same maps so their scores are comparable.
+    std::vector<int> maps;
+    std::uniform_int_distribution<int> pick(1, kNumMaps);
+    for (int m = 0; m < options.maps_per_generation; ++m)
+      maps.push_back(pick(rng));
+
+    std::vector<Game> games;
+    for (size_t c = 0; c < population.size(); ++c) {
+      population[c].games = 0;
+      population[c].points = 0;
+      for (size_t m = 0; m < maps.size(); ++m) {
+        for (size_t o = 0; o < options.opponents.size(); ++o) {
+          Game g = { (int)c, maps[m], options.opponents[o] };
+          games.push_back(g);
+        }
+      }
+    }
+    PlayGames(options, games, population);
+    std::stable_sort(population.begin(), population.end(), BetterCandidate);
+
+    printf("generation %d\n", gen);
+    for (int i = 0; i < options.elite; ++i)
+      Print(population[i]);
+    best.insert(best.end(), population.begin(),
+                population.begin() + options.elite);
+
+    // Elites survive, the rest are children of two tournament winners.
+    std::vector<Candidate> next(population.begin(),
+                                population.begin() + options.elite);
+    std::uniform_int_distribution<int> any(0, population.size() - 1);
+    while ((int)next.size() < options.population) {
+      int a = std::min(any(rng), any(rng));
+      int b = std::min(any(rng), any(rng));
+      Candidate child;
+      child.params = Mutate(Crossover(population[a].params,
+                                      population[b].params, rng), rng);
+      next.push_back(child);
+    }
+    population = next;
+  }
+
+  // Re-play the best distinct sets on every map for a tighter interval.
+  std::map<std::string, Candidate> distinct;
+  std::stable_sort(best.begin(), best.end(), BetterCandidate);
+  for (size_t i = 0; i < best.size(); ++i) {
+    if ((int)distinct.size() == options.top)
+      break;
+    Candidate c;
+    c.params = best[i].params;
+    distinct.insert(std::make_pair(c.params.ToString(), c));
+  }
+  std::vector<Candidate> finalists;
+  for (std::map<std::string, Candidate>::const_iterator it = distinct.begin();
+       it != distinct.end(); ++it)
+    finalists.push_back(it->second);
+
+  std::vector<Game> games;
+  for (size_t c = 0; c < finalists.size(); ++c) {
+    for (int m = 1; m <= kNumMaps; ++m) {
+      for (size_t o = 0; o < options.opponents.size(); ++o) {
+        Game g = { (int)c, m, options.opponents[o] };
+        games.push_back(g);
+      }
+    }
+  }
+  PlayGames(options, games, finalists);
+  std::stable_sort(finalists.begin(), finalists.end(), BetterCandidate);
+
+  printf("best\n");
+  for (size_t i = 0; i < finalists.size(); ++i)
+    Print(finalists[i]);
+  return 0;
+}